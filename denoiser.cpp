@@ -0,0 +1,288 @@
+#include "denoiser.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+void GBuffer::allocate(FrameArena& arena, int w, int h) {
+    width = w;
+    height = h;
+    const size_t count = size_t(w) * h;
+    r = arena.allocateArray<float>(count);
+    g = arena.allocateArray<float>(count);
+    b = arena.allocateArray<float>(count);
+    nx = arena.allocateArray<float>(count);
+    ny = arena.allocateArray<float>(count);
+    nz = arena.allocateArray<float>(count);
+    depth = arena.allocateArray<float>(count);
+    objectId = arena.allocateArray<int>(count);
+    variance = arena.allocateArray<float>(count);
+}
+
+namespace {
+
+// 법선 가중치 = dot^(2^kNormalSharpness) = dot^128 (상수라야 내부 루프가 벡터화됨)
+constexpr int kNormalSharpness = 7;
+
+// 행 안에서 한 번에 처리하는 픽셀 수
+constexpr int kChunk = 256;
+
+// 한 행의 연속 구간에 대한 포인터 묶음
+struct TapRow {
+    const float* nx;
+    const float* ny;
+    const float* nz;
+    const float* depth;
+    const float* luminance;
+    const float* objectId;
+    const float* luminanceScale; // 중심만: 1 / (sigmaLuminance * 표준편차)
+    const float* variance;       // 탭만
+    const float* r;
+    const float* g;
+    const float* b;
+};
+
+// max(v, 0): 분기/fmax 없이 (내부 루프 if-conversion 실패 방지)
+inline float positivePart(float v) {
+    return 0.5f * (v + std::fabs(v));
+}
+
+// e^-x (x >= 0): 2^-n * 2^-f 분해 (floor 대신 양수 절단이라 벡터화됨), 상대 오차 ~1e-4
+inline float fastExpNeg(float x) {
+    float y = x * 1.44269504f;
+    y -= positivePart(y - 125.0f); // min(y, 125)
+    int32_t n = int32_t(y);
+    float g = 1.0f - (y - float(n)); // 2^-f = 2^g / 2, g ∈ (0, 1]
+    float p = 1.0f + g * (0.69314718f + g * (0.24022650f + g * (0.05550411f + g * 0.00961813f)));
+    int32_t bits = (126 - n) << 23;
+    float scale;
+    std::memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+// v^(2^N): 컴파일 타임에 펼쳐져 내부 루프에 분기가 없음
+template<int N>
+inline float repeatSquare(float v) {
+    if constexpr (N == 0) return v;
+    else return repeatSquare<N - 1>(v * v);
+}
+
+// AVX2/FMA가 있으면 8칸 벡터 버전을 실행 시점에 고름 (GCC, ifunc가 있는 x86 ELF에서만. 나머지는 기본 빌드)
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__ELF__)
+#define DENOISER_TARGET_CLONES __attribute__((target_clones("arch=x86-64-v3", "default")))
+#else
+#define DENOISER_TARGET_CLONES
+#endif
+
+// 탭 하나(고정 오프셋)를 count개 픽셀에 누적 (분산은 가중치 제곱으로)
+DENOISER_TARGET_CLONES
+void accumulateTap(int count, float k, float invSigmaDepth, const TapRow& center, const TapRow& tap,
+                   float* __restrict sumR, float* __restrict sumG, float* __restrict sumB, float* __restrict sumW,
+                   float* __restrict sumV) {
+    const float* __restrict pnx = center.nx;
+    const float* __restrict pny = center.ny;
+    const float* __restrict pnz = center.nz;
+    const float* __restrict pdepth = center.depth;
+    const float* __restrict plum = center.luminance;
+    const float* __restrict pid = center.objectId;
+    const float* __restrict pscale = center.luminanceScale;
+    const float* __restrict qnx = tap.nx;
+    const float* __restrict qny = tap.ny;
+    const float* __restrict qnz = tap.nz;
+    const float* __restrict qdepth = tap.depth;
+    const float* __restrict qlum = tap.luminance;
+    const float* __restrict qid = tap.objectId;
+    const float* __restrict qvar = tap.variance;
+    const float* __restrict qr = tap.r;
+    const float* __restrict qg = tap.g;
+    const float* __restrict qb = tap.b;
+
+    for (int x = 0; x < count; ++x) {
+        float wn = pnx[x] * qnx[x] + pny[x] * qny[x] + pnz[x] * qnz[x];
+        wn = positivePart(wn);
+        wn = repeatSquare<kNormalSharpness>(wn);
+
+        // 깊이/휘도 가중치는 exp 하나로 합침: e^-a * e^-b = e^-(a+b)
+        const float distance = std::fabs(pdepth[x] - qdepth[x]) * invSigmaDepth
+                             + std::fabs(plum[x] - qlum[x]) * pscale[x];
+        const float wid = positivePart(1.0f - std::fabs(pid[x] - qid[x])); // 같은 물체면 1, 아니면 0
+
+        const float weight = k * wn * wid * fastExpNeg(distance);
+        sumR[x] += weight * qr[x];
+        sumG[x] += weight * qg[x];
+        sumB[x] += weight * qb[x];
+        sumW[x] += weight;
+        sumV[x] += weight * weight * qvar[x];
+    }
+}
+
+}
+
+void Denoiser::apply(GBuffer& gbuffer) const {
+    const int w = gbuffer.width;
+    const int h = gbuffer.height;
+    if (w <= 0 || h <= 0 || iterations <= 0) return;
+
+    static const float kernel[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+
+    ThreadPool& pool = ThreadPool::instance();
+    FrameArena& arena = FrameArena::local();
+    const size_t count = size_t(w) * h;
+
+    // 가로 패스 결과 (세로 패스가 원본 radiance 평면에 다시 씀)
+    float* src[3] = { gbuffer.r, gbuffer.g, gbuffer.b };
+    float* dst[3] = { arena.allocateArray<float>(count), arena.allocateArray<float>(count), arena.allocateArray<float>(count) };
+    float* luminance = arena.allocateArray<float>(count);
+    float* luminanceScale = arena.allocateArray<float>(count);
+    float* objectId = arena.allocateArray<float>(count); // 정수 비교 대신 float 연산으로 가중치 계산
+    float* variance[2] = { arena.allocateArray<float>(count), arena.allocateArray<float>(count) };
+
+    // 워커별 행 누산기: 각 워커가 자기 스레드 아레나에서 처음 쓸 때 할당
+    float** rowScratch = arena.allocateArray<float*>(pool.workerCount());
+    std::fill(rowScratch, rowScratch + pool.workerCount(), nullptr);
+    auto workerScratch = [&](int worker) {
+        float*& scratch = rowScratch[worker];
+        if (!scratch) scratch = FrameArena::local().allocateArray<float>(size_t(w) * 5);
+        return scratch;
+    };
+
+    const float* nx = gbuffer.nx;
+    const float* ny = gbuffer.ny;
+    const float* nz = gbuffer.nz;
+    const float* depth = gbuffer.depth;
+    auto luminanceOf = [](float r, float g, float b) { return 0.2126f * r + 0.7152f * g + 0.0722f * b; };
+    pool.parallelFor(h, [&](int y, int) {
+        const size_t row = size_t(y) * w;
+        for (int x = 0; x < w; ++x) {
+            objectId[row + x] = float(gbuffer.objectId[row + x]);
+            luminance[row + x] = luminanceOf(gbuffer.r[row + x], gbuffer.g[row + x], gbuffer.b[row + x]);
+        }
+    });
+
+    // 처음 분산: 트레이서가 샘플로 구한 값, 없으면(1 spp) 같은 물체의 3x3 이웃 휘도 분산
+    // (이웃마다 연속 구간을 도는 분기 없는 루프, 다른 물체는 가중치 0)
+    pool.parallelFor(h, [&](int y, int worker) {
+        float* scratch = workerScratch(worker);
+        float* sum = scratch;
+        float* sumSquares = scratch + w;
+        float* n = scratch + 2 * w;
+        std::fill(scratch, scratch + size_t(w) * 3, 0.0f);
+
+        const size_t row = size_t(y) * w;
+        const float* pid = objectId + row;
+        for (int yy = std::max(0, y - 1); yy <= std::min(h - 1, y + 1); ++yy) {
+            for (int offset = -1; offset <= 1; ++offset) {
+                const int x0 = std::max(0, -offset);
+                const int x1 = std::min(w, w - offset);
+                const float* qid = objectId + size_t(yy) * w + offset;
+                const float* qlum = luminance + size_t(yy) * w + offset;
+                for (int x = x0; x < x1; ++x) {
+                    const float same = positivePart(1.0f - std::fabs(pid[x] - qid[x]));
+                    sum[x] += same * qlum[x];
+                    sumSquares[x] += same * qlum[x] * qlum[x];
+                    n[x] += same;
+                }
+            }
+        }
+        for (int x = 0; x < w; ++x) {
+            const float mean = sum[x] / n[x];
+            variance[0][row + x] = std::max(0.0f, sumSquares[x] / n[x] - mean * mean);
+        }
+        if (gbuffer.variance) {
+            for (int x = 0; x < w; ++x) {
+                if (gbuffer.variance[row + x] >= 0.0f) variance[0][row + x] = gbuffer.variance[row + x];
+            }
+        }
+    });
+
+    // 한 방향 5탭 패스: in → out (가로는 같은 행의 오프셋, 세로는 다른 행의 같은 열)
+    auto filterPass = [&](float* const in[3], float* const out[3], const float* varianceIn, float* varianceOut,
+                          bool vertical, int step, float invSigmaDepth) {
+        const float* sr = in[0];
+        const float* sg = in[1];
+        const float* sb = in[2];
+        // 휘도 허용 차이는 3x3 가우시안(세로 → 가로)으로 편 분산의 표준편차에 비례 (SVGF)
+        pool.parallelFor(h, [&](int y, int worker) {
+            float* column = workerScratch(worker); // 세로로 편 분산 한 행
+            const size_t row = size_t(y) * w;
+            const float* above = varianceIn + size_t(std::max(0, y - 1)) * w;
+            const float* below = varianceIn + size_t(std::min(h - 1, y + 1)) * w;
+            for (int x = 0; x < w; ++x) {
+                luminance[row + x] = luminanceOf(sr[row + x], sg[row + x], sb[row + x]);
+                column[x] = 0.25f * above[x] + 0.5f * varianceIn[row + x] + 0.25f * below[x];
+            }
+            for (int x = 0; x < w; ++x) {
+                const float left = column[std::max(0, x - 1)];
+                const float right = column[std::min(w - 1, x + 1)];
+                const float v = 0.25f * left + 0.5f * column[x] + 0.25f * right;
+                luminanceScale[row + x] = 1.0f / (sigmaLuminance * std::sqrt(v) + 1e-4f);
+            }
+        });
+
+        pool.parallelFor(h, [&](int y, int worker) {
+            float* scratch = workerScratch(worker);
+            float* sumR = scratch;
+            float* sumG = scratch + w;
+            float* sumB = scratch + 2 * w;
+            float* sumW = scratch + 3 * w;
+            float* sumV = scratch + 4 * w;
+            std::fill(scratch, scratch + size_t(w) * 5, 0.0f);
+
+            const size_t row = size_t(y) * w;
+
+            // 행을 kChunk 픽셀 구간으로 나눠 5탭을 차례로 (중심/누산기가 L1에 남도록)
+            for (int c0 = 0; c0 < w; c0 += kChunk) {
+                const int c1 = std::min(w, c0 + kChunk);
+                for (int k = -2; k <= 2; ++k) {
+                    const int yy = vertical ? y + k * step : y;
+                    const int offset = vertical ? 0 : k * step;
+                    if (yy < 0 || yy >= h) continue;
+                    const size_t tapRow = size_t(yy) * w;
+
+                    // 이미지 안에 있는 탭만 (연속 구간이라 분기 없는 루프)
+                    const int x0 = std::max(c0, -offset);
+                    const int x1 = std::min(c1, w - offset);
+                    if (x1 <= x0) continue;
+
+                    const size_t p = row + x0;
+                    const size_t q = tapRow + x0 + offset;
+                    TapRow center = { nx + p, ny + p, nz + p, depth + p, luminance + p, objectId + p, luminanceScale + p,
+                                      nullptr, nullptr, nullptr, nullptr };
+                    TapRow tap = { nx + q, ny + q, nz + q, depth + q, luminance + q, objectId + q, nullptr,
+                                   varianceIn + q, sr + q, sg + q, sb + q };
+                    accumulateTap(x1 - x0, kernel[k + 2], invSigmaDepth, center, tap,
+                                  sumR + x0, sumG + x0, sumB + x0, sumW + x0, sumV + x0);
+                }
+            }
+
+            for (int x = 0; x < w; ++x) {
+                // 미스 픽셀(법선 0)은 가중치가 0이 되므로 원래 값 유지
+                if (sumW[x] > 1e-6f) {
+                    const float inv = 1.0f / sumW[x];
+                    out[0][row + x] = sumR[x] * inv;
+                    out[1][row + x] = sumG[x] * inv;
+                    out[2][row + x] = sumB[x] * inv;
+                    varianceOut[row + x] = sumV[x] * inv * inv;
+                } else {
+                    out[0][row + x] = sr[row + x];
+                    out[1][row + x] = sg[row + x];
+                    out[2][row + x] = sb[row + x];
+                    varianceOut[row + x] = varianceIn[row + x];
+                }
+            }
+        });
+    };
+
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        const int step = 1 << iteration;
+        const float invSigmaDepth = 1.0f / (sigmaDepth * step);
+        filterPass(src, dst, variance[0], variance[1], false, step, invSigmaDepth);
+        filterPass(dst, src, variance[1], variance[0], true, step, invSigmaDepth);
+    }
+
+    gbuffer.r = src[0];
+    gbuffer.g = src[1];
+    gbuffer.b = src[2];
+}
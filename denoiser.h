@@ -0,0 +1,44 @@
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include "framearena.h"
+
+// 트레이서가 픽셀마다 기록하는 버퍼 (SoA: 채널별 평면 배열)
+struct GBuffer {
+    int width = 0;
+    int height = 0;
+
+    float* r = nullptr;      // radiance
+    float* g = nullptr;
+    float* b = nullptr;
+    float* nx = nullptr;     // 1차 히트 법선
+    float* ny = nullptr;
+    float* nz = nullptr;
+    float* depth = nullptr;  // 1차 히트 거리 (미스는 큰 값)
+    int* objectId = nullptr; // 미스는 -1
+    float* variance = nullptr; // 픽셀 평균 휘도의 분산 (1 spp는 -1: 디노이저가 주변 픽셀로 추정)
+
+    // 프레임 아레나에서 할당 (FrameArena::endFrame()에서 해제)
+    void allocate(FrameArena& arena, int w, int h);
+};
+
+// Edge-aware à-trous wavelet 필터 (SVGF의 분산 기반 휘도 가중치)
+// - 5탭 B3-spline 커널을 가로 → 세로로 나눠 (반복당 25탭 대신 10탭) 간격 1, 2, 4, ...로 넓혀 가며 반복
+// - 법선/깊이/objectId 차이로 가중치를 줄여 경계는 보존 (패스마다 적용)
+// - 휘도 차이는 중심 픽셀 노이즈의 표준편차 배수로 잼: 노이즈 없는 영역(텍스처, 하드 섀도우 경계, 반사)은
+//   거의 흐리지 않고 노이즈가 큰 영역만 넓게 흐림. 분산은 가중치 제곱으로 필터와 함께 줄어듦
+// - 행 단위 병렬 + 탭마다 연속 구간을 도는 내부 루프 (자동 벡터화 대상, x86 GCC에서는 AVX2 버전도 빌드)
+// 1080p 3회 반복: 코어 하나에서 ~305 ms (AVX2). 목표였던 "1080p에서 수 ms"는 CPU로는 닿지 않음
+// (코어 수만큼 나뉘어도 수십 ms). 품질은 회귀 하네스의 denoise-soft-shadows-* 장면에서 64 spp 기준과 비교:
+// 디노이즈한 1 spp는 디노이즈 안 한 4 spp 근처, 4 spp는 16 spp에 못 미침 (64 spp를 대신하지는 못함)
+class Denoiser {
+public:
+    int iterations = 3;
+    float sigmaDepth = 0.25f;    // 간격 1 기준 깊이 허용 차이
+    float sigmaLuminance = 4.0f; // 휘도 허용 차이 (노이즈 표준편차의 배수)
+
+    // gbuffer.r/g/b를 필터 결과로 교체 (결과는 프레임 아레나에 있을 수 있음)
+    void apply(GBuffer& gbuffer) const;
+};
+
+#endif // DENOISER_H
@@ -0,0 +1,550 @@
+#include "distributed.h"
+#include "openglwindow.h"
+#include "framearena.h"
+#include "threadpool.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QEventLoop>
+#include <QHostAddress>
+#include <QProcess>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point start, Clock::time_point end = Clock::now()) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// === 프로토콜 ===
+// [quint32 payload 크기][quint8 종류][payload]
+// Scene: 코디네이터 → 워커, 접속 직후 한 번
+// Tile: 코디네이터 → 워커 (id, x, y, w, h)
+// TileResult: 워커 → 코디네이터 (id, 추적 시간, G-buffer 평면 8개 원시 바이트)
+enum class MessageType : quint8 { Scene = 1, Tile = 2, TileResult = 3 };
+
+const qint64 kHeaderBytes = 5;
+const int kTileResultHeaderBytes = 12; // qint32 id + double traceMs
+const int kTilePlanes = 9;             // r, g, b, nx, ny, nz, depth, objectId, variance (모두 4바이트)
+const quint32 kSceneMagic = 0x43575256; // 장면 형식이 바뀌면 올림 (다른 버전 워커는 거절)
+
+void sendMessage(QTcpSocket* socket, MessageType type, const QByteArray& payload) {
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out << quint32(payload.size()) << quint8(type);
+    socket->write(header);
+    socket->write(payload);
+    socket->flush(); // 다음 타일을 계산하는 동안 이벤트 루프를 기다리지 않도록
+}
+
+// 메시지가 다 도착했으면 꺼냄
+bool takeMessage(QTcpSocket* socket, MessageType& type, QByteArray& payload) {
+    if (socket->bytesAvailable() < kHeaderBytes) return false;
+    const QByteArray header = socket->peek(kHeaderBytes);
+    QDataStream in(header);
+    quint32 size;
+    quint8 rawType;
+    in >> size >> rawType;
+    if (socket->bytesAvailable() < kHeaderBytes + qint64(size)) return false;
+    socket->read(kHeaderBytes);
+    payload = socket->read(size);
+    type = MessageType(rawType);
+    return true;
+}
+
+// === 장면 직렬화 ===
+// 메쉬는 원시 바이트 그대로 보냄 (코디네이터와 워커의 바이트 순서가 같다고 가정)
+QByteArray serializeScene(const RayTracer& tracer, const DistributedOptions& options) {
+    const ObjLoader& mesh = tracer.model();
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    out << kSceneMagic << qint32(options.width) << qint32(options.height);
+    out << quint32(mesh.vertices.size());
+    out.writeRawData(reinterpret_cast<const char*>(mesh.vertices.data()), int(mesh.vertices.size() * sizeof(Vertex)));
+    out << quint32(mesh.faces.size());
+    out.writeRawData(reinterpret_cast<const char*>(mesh.faces.data()), int(mesh.faces.size() * sizeof(Face)));
+
+    out << quint32(tracer.instances().size());
+    for (const RayTracer::Instance& instance : tracer.instances()) {
+        out << instance.transform << qint32(instance.objectId);
+    }
+    out << quint32(tracer.lights().size());
+    for (const RayTracer::Light& light : tracer.lights()) {
+        out << light.position << light.color;
+    }
+
+    out << tracer.cameraPos << qint32(tracer.maxDepth) << qint32(options.samplesPerPixel)
+        << tracer.shadows << tracer.reflections << tracer.denoise << tracer.lightRadius << qint32(tracer.exhaustiveLightLimit)
+        << tracer.russianRoulette << tracer.rouletteThreshold
+        << tracer.lightmap << tracer.lightmapDensity << qint32(tracer.lightmapSamples);
+    return data;
+}
+
+bool deserializeScene(const QByteArray& data, ObjLoader& mesh, RayTracer& tracer, int& width, int& height) {
+    QDataStream in(data);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 magic;
+    qint32 w, h;
+    in >> magic >> w >> h;
+    if (magic != kSceneMagic || w <= 0 || h <= 0) return false;
+    width = w;
+    height = h;
+
+    quint32 count;
+    in >> count;
+    if (qint64(count) * qint64(sizeof(Vertex)) > data.size()) return false;
+    mesh.vertices.resize(count);
+    in.readRawData(reinterpret_cast<char*>(mesh.vertices.data()), int(count * sizeof(Vertex)));
+    in >> count;
+    if (qint64(count) * qint64(sizeof(Face)) > data.size()) return false;
+    mesh.faces.resize(count);
+    in.readRawData(reinterpret_cast<char*>(mesh.faces.data()), int(count * sizeof(Face)));
+
+    in >> count;
+    if (count > 1024) return false;
+    std::vector<RayTracer::Instance> instances(count);
+    for (RayTracer::Instance& instance : instances) {
+        qint32 objectId;
+        in >> instance.transform >> objectId;
+        instance.objectId = objectId;
+    }
+    in >> count;
+    if (count > (1u << 20)) return false;
+    std::vector<RayTracer::Light> lights(count);
+    for (RayTracer::Light& light : lights) {
+        in >> light.position >> light.color;
+    }
+
+    qint32 maxDepth, spp, exhaustiveLightLimit, lightmapSamples;
+    in >> tracer.cameraPos >> maxDepth >> spp >> tracer.shadows >> tracer.reflections >> tracer.denoise >> tracer.lightRadius >> exhaustiveLightLimit
+       >> tracer.russianRoulette >> tracer.rouletteThreshold
+       >> tracer.lightmap >> tracer.lightmapDensity >> lightmapSamples;
+    if (in.status() != QDataStream::Ok) return false;
+
+    tracer.maxDepth = maxDepth;
+    tracer.samplesPerPixel = spp;
+    tracer.exhaustiveLightLimit = exhaustiveLightLimit;
+    tracer.lightmapSamples = lightmapSamples;
+    tracer.setInstances(instances); // 메쉬를 채운 뒤 (바운딩 박스 계산)
+    tracer.setLights(lights);
+    return true;
+}
+
+QByteArray encodeTileResult(qint32 tileId, double traceMs, const GBuffer& tile) {
+    QByteArray data;
+    {
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << tileId << traceMs;
+    }
+    const int bytes = tile.width * tile.height * 4;
+    const void* planes[kTilePlanes] = { tile.r, tile.g, tile.b, tile.nx, tile.ny, tile.nz, tile.depth, tile.objectId, tile.variance };
+    data.reserve(kTileResultHeaderBytes + kTilePlanes * bytes);
+    for (const void* plane : planes) data.append(static_cast<const char*>(plane), bytes);
+    return data;
+}
+
+// === 코디네이터 상태 ===
+struct Tile {
+    int x, y, w, h;
+    bool done = false;
+    bool reassigned = false; // 느려서 한 번 더 맡겼는지 (한 번만)
+};
+
+struct Assignment {
+    int tile;
+    Clock::time_point start;
+};
+
+struct WorkerState {
+    QTcpSocket* socket = nullptr;
+    QString name;
+    bool alive = true;
+    std::vector<Assignment> inFlight;
+    int tilesDone = 0;
+    qint64 pixels = 0;
+    double computeMs = 0.0; // 워커가 보고한 추적 시간 합
+    Clock::time_point connected;
+    Clock::time_point lastResult;
+
+    bool holds(int tile) const {
+        return std::any_of(inFlight.begin(), inFlight.end(), [tile](const Assignment& a) { return a.tile == tile; });
+    }
+};
+
+} // namespace
+
+int runDistributedRender(const DistributedOptions& options) {
+    if (options.outputPath.isEmpty() || options.cowPath.isEmpty()) {
+        std::cerr << "Distributed render needs an output path and --cow." << std::endl;
+        return 1;
+    }
+
+    // 장면은 위젯과 같은 기본 상태 (광원, 소 두 마리 변환)
+    OpenGLWindow window;
+    window.loadModel(options.cowPath.toStdString());
+    const RayTracer& tracer = window.tracer();
+    if (tracer.model().faces.empty()) return 1;
+
+    const QByteArray scene = serializeScene(tracer, options);
+    const int width = options.width;
+    const int height = options.height;
+
+    // 디노이즈 판단(spp 등)이 워커와 같도록 워커가 받는 장면 그대로 resolve용 트레이서를 만듦
+    ObjLoader resolveMesh;
+    RayTracer resolveTracer(resolveMesh);
+    int sceneWidth, sceneHeight;
+    if (!deserializeScene(scene, resolveMesh, resolveTracer, sceneWidth, sceneHeight)) return 1;
+    const int tileSize = std::max(8, options.tileSize);
+
+    std::vector<Tile> tiles;
+    for (int y = 0; y < height; y += tileSize) {
+        for (int x = 0; x < width; x += tileSize) {
+            tiles.push_back({ x, y, std::min(tileSize, width - x), std::min(tileSize, height - y) });
+        }
+    }
+    std::deque<int> pending;
+    for (int i = 0; i < int(tiles.size()); ++i) pending.push_back(i);
+
+    GBuffer frame;
+    frame.allocate(FrameArena::local(), width, height);
+
+    QTcpServer server;
+    if (!server.listen(QHostAddress(options.host), quint16(options.port))) {
+        std::cerr << "Failed to listen on " << options.host.toStdString() << ": "
+                  << server.errorString().toStdString() << std::endl;
+        return 1;
+    }
+    const quint16 port = server.serverPort();
+    std::cout << "Coordinator: " << tiles.size() << " tiles of " << tileSize << "px, scene "
+              << scene.size() / 1024 << " KiB, listening on " << options.host.toStdString() << ":" << port << std::endl;
+
+    std::vector<std::unique_ptr<WorkerState>> workers;
+    int completed = 0;
+    int reassignedTiles = 0;
+    int duplicateResults = 0;
+    int lostWorkers = 0;
+    double roundTripSum = 0.0;
+    bool finished = false;
+    bool failed = false;
+    Clock::time_point lastAlive = Clock::now();
+    const Clock::time_point start = Clock::now();
+    QEventLoop loop;
+
+    // 이 워커가 아직 맡지 않은, 끝나지 않은 타일을 빈 슬롯만큼 보냄
+    auto dispatch = [&](WorkerState& worker) {
+        while (worker.alive && int(worker.inFlight.size()) < std::max(1, options.tilesInFlight)) {
+            auto next = pending.end();
+            for (auto it = pending.begin(); it != pending.end();) {
+                if (tiles[*it].done) { it = pending.erase(it); continue; }
+                if (!worker.holds(*it)) { next = it; break; }
+                ++it;
+            }
+            if (next == pending.end()) return;
+
+            const int id = *next;
+            pending.erase(next);
+            const Tile& tile = tiles[id];
+            QByteArray payload;
+            QDataStream out(&payload, QIODevice::WriteOnly);
+            out << qint32(id) << qint32(tile.x) << qint32(tile.y) << qint32(tile.w) << qint32(tile.h);
+            worker.inFlight.push_back({ id, Clock::now() });
+            sendMessage(worker.socket, MessageType::Tile, payload);
+        }
+    };
+    auto dispatchAll = [&] {
+        for (auto& worker : workers) dispatch(*worker);
+    };
+    auto heldByOther = [&](int id, const WorkerState* except) {
+        for (const auto& worker : workers) {
+            if (worker.get() != except && worker->alive && worker->holds(id)) return true;
+        }
+        return false;
+    };
+
+    auto dropWorker = [&](WorkerState& worker) {
+        if (!worker.alive || finished) return;
+        worker.alive = false;
+        ++lostWorkers;
+        int recovered = 0;
+        for (const Assignment& assignment : worker.inFlight) {
+            if (!tiles[assignment.tile].done && !heldByOther(assignment.tile, &worker)) {
+                pending.push_front(assignment.tile);
+                ++recovered;
+            }
+        }
+        worker.inFlight.clear();
+        std::cout << "Worker " << worker.name.toStdString() << " disconnected, " << recovered << " tiles requeued" << std::endl;
+        dispatchAll();
+    };
+
+    auto handleResult = [&](WorkerState& worker, const QByteArray& payload) {
+        QDataStream in(payload);
+        qint32 id;
+        double traceMs;
+        in >> id >> traceMs;
+
+        auto assignment = std::find_if(worker.inFlight.begin(), worker.inFlight.end(),
+                                       [id](const Assignment& a) { return a.tile == id; });
+        if (assignment == worker.inFlight.end()) {
+            std::cerr << "Worker " << worker.name.toStdString() << " returned an unassigned tile " << id << std::endl;
+            return;
+        }
+        const double roundTripMs = elapsedMs(assignment->start);
+        worker.inFlight.erase(assignment);
+
+        Tile& tile = tiles[id];
+        const int bytes = tile.w * tile.h * 4;
+        if (payload.size() != kTileResultHeaderBytes + kTilePlanes * bytes) {
+            std::cerr << "Worker " << worker.name.toStdString() << " sent a malformed tile " << id << std::endl;
+            if (!tile.done && !heldByOther(id, &worker)) pending.push_front(id);
+            return;
+        }
+        if (tile.done) {
+            ++duplicateResults; // 재할당된 타일의 늦은 쪽
+            return;
+        }
+
+        // 타일 → 프레임 G-buffer (평면마다 행 단위 복사)
+        void* planes[kTilePlanes] = { frame.r, frame.g, frame.b, frame.nx, frame.ny, frame.nz, frame.depth, frame.objectId, frame.variance };
+        const char* src = payload.constData() + kTileResultHeaderBytes;
+        for (void* plane : planes) {
+            char* dst = static_cast<char*>(plane);
+            for (int row = 0; row < tile.h; ++row) {
+                std::memcpy(dst + (size_t(tile.y + row) * width + tile.x) * 4, src + size_t(row) * tile.w * 4, size_t(tile.w) * 4);
+            }
+            src += bytes;
+        }
+
+        tile.done = true;
+        ++completed;
+        ++worker.tilesDone;
+        worker.pixels += qint64(tile.w) * tile.h;
+        worker.computeMs += traceMs;
+        worker.lastResult = Clock::now();
+        roundTripSum += roundTripMs;
+
+        if (completed == options.killWorkerAfterTiles) {
+            // 장애 테스트: 살아 있는 워커 하나를 끊음 (워커 프로세스는 연결이 끊기면 종료)
+            for (auto& victim : workers) {
+                if (victim->alive) {
+                    std::cout << "Fault test: dropping worker " << victim->name.toStdString() << std::endl;
+                    victim->socket->abort();
+                    dropWorker(*victim);
+                    break;
+                }
+            }
+        }
+        if (completed == int(tiles.size())) {
+            finished = true;
+            loop.quit();
+        }
+    };
+
+    QObject::connect(&server, &QTcpServer::newConnection, [&] {
+        while (QTcpSocket* socket = server.nextPendingConnection()) {
+            workers.push_back(std::make_unique<WorkerState>());
+            WorkerState* worker = workers.back().get();
+            worker->socket = socket;
+            worker->name = socket->peerAddress().toString() + ":" + QString::number(socket->peerPort());
+            worker->connected = worker->lastResult = Clock::now();
+
+            QObject::connect(socket, &QTcpSocket::readyRead, [&, worker] {
+                MessageType type;
+                QByteArray payload;
+                while (worker->alive && takeMessage(worker->socket, type, payload)) {
+                    if (type == MessageType::TileResult) handleResult(*worker, payload);
+                }
+                if (!finished) dispatch(*worker);
+            });
+            QObject::connect(socket, &QTcpSocket::disconnected, [&, worker] { dropWorker(*worker); });
+
+            std::cout << "Worker " << worker->name.toStdString() << " connected" << std::endl;
+            sendMessage(socket, MessageType::Scene, scene);
+            dispatch(*worker);
+        }
+    });
+
+    // 느린 타일 재할당 + 워커가 하나도 없을 때의 타임아웃
+    QTimer watchdog;
+    QObject::connect(&watchdog, &QTimer::timeout, [&] {
+        const Clock::time_point now = Clock::now();
+        const double meanRoundTrip = completed > 0 ? roundTripSum / completed : 0.0;
+        const double threshold = std::max(double(options.minReassignMs), options.slowTileFactor * meanRoundTrip);
+
+        bool anyAlive = false;
+        for (auto& worker : workers) {
+            if (!worker->alive) continue;
+            anyAlive = true;
+            for (const Assignment& assignment : worker->inFlight) {
+                Tile& tile = tiles[assignment.tile];
+                if (!tile.done && !tile.reassigned && elapsedMs(assignment.start, now) > threshold) {
+                    tile.reassigned = true;
+                    pending.push_front(assignment.tile);
+                    ++reassignedTiles;
+                }
+            }
+        }
+        dispatchAll();
+
+        if (anyAlive) {
+            lastAlive = now;
+        } else if (elapsedMs(lastAlive, now) > options.connectTimeoutMs) {
+            std::cerr << "No live workers for " << options.connectTimeoutMs << " ms, giving up with "
+                      << completed << "/" << tiles.size() << " tiles" << std::endl;
+            failed = true;
+            loop.quit();
+        }
+    });
+    watchdog.start(200);
+
+    // 로컬 워커 프로세스 (같은 실행 파일)
+    // 로컬 워커끼리 코어를 나눠 가짐 (워커마다 전체 스레드 풀이면 코어 수 × 워커 수 스레드)
+    std::vector<std::unique_ptr<QProcess>> processes;
+    const int threadsPerWorker = std::max(1, int(std::thread::hardware_concurrency()) / std::max(1, options.localWorkers));
+    for (int i = 0; i < options.localWorkers; ++i) {
+        QStringList arguments = { "--worker", options.host + ":" + QString::number(port),
+                                  "--worker-threads", QString::number(threadsPerWorker) };
+        if (i < options.slowWorkers) {
+            arguments << "--worker-delay" << QString::number(options.slowWorkerDelayMs);
+        }
+        processes.push_back(std::make_unique<QProcess>());
+        processes.back()->setProcessChannelMode(QProcess::ForwardedChannels);
+        processes.back()->start(QCoreApplication::applicationFilePath(), arguments);
+    }
+
+    if (!tiles.empty()) loop.exec();
+    watchdog.stop();
+    finished = true;
+    const double totalMs = elapsedMs(start);
+
+    // 람다가 잡은 지역 변수보다 소켓(server 자식)이 늦게 소멸하므로 연결부터 해제
+    server.disconnect();
+    server.close();
+    for (auto& worker : workers) {
+        worker->socket->disconnect();
+        worker->socket->abort(); // 워커는 연결이 끊기면 종료
+    }
+    for (auto& process : processes) {
+        if (!process->waitForFinished(5000)) process->kill();
+        process->waitForFinished(1000);
+    }
+
+    // 리포트: 워커별 처리량 + 부하 균형 (픽셀 수 최대 / 평균)
+    qint64 maxPixels = 0;
+    qint64 sumPixels = 0;
+    int contributing = 0;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& worker : workers) {
+        const double activeSeconds = std::max(1e-3, elapsedMs(worker->connected, worker->lastResult) / 1000.0);
+        const double mpix = worker->pixels / 1e6;
+        std::cout << "  worker " << worker->name.toStdString() << (worker->alive ? "" : " (lost)")
+                  << ": tiles " << worker->tilesDone
+                  << " (" << 100.0 * worker->tilesDone / std::max<size_t>(1, tiles.size()) << "%)"
+                  << ", " << mpix << " Mpix, compute " << worker->computeMs / 1000.0 << " s"
+                  << ", " << mpix / activeSeconds << " Mpix/s" << std::endl;
+        if (worker->pixels > 0) {
+            maxPixels = std::max(maxPixels, worker->pixels);
+            sumPixels += worker->pixels;
+            ++contributing;
+        }
+    }
+    const double imbalance = contributing > 0 ? maxPixels / (double(sumPixels) / contributing) : 0.0;
+    std::cout << "Distributed render: " << width << "x" << height << ", " << completed << "/" << tiles.size()
+              << " tiles, " << workers.size() << " workers, " << totalMs / 1000.0 << " s ("
+              << (double(width) * height / 1e6) / (totalMs / 1000.0) << " Mpix/s)" << std::endl;
+    std::cout << "Load balance: max/mean pixels " << imbalance << ", reassigned " << reassignedTiles
+              << ", duplicates discarded " << duplicateResults << ", workers lost " << lostWorkers << std::endl;
+
+    int result = 0;
+    if (failed || completed != int(tiles.size())) {
+        result = 1;
+    } else {
+        QImage image(width, height, QImage::Format_RGB32);
+        double denoiseMs = resolveTracer.resolve(frame, image);
+        std::cout << "Denoise " << denoiseMs << " ms" << std::endl;
+        if (!image.save(options.outputPath)) {
+            std::cerr << "Failed to write " << options.outputPath.toStdString() << std::endl;
+            result = 1;
+        } else {
+            std::cout << "Wrote " << options.outputPath.toStdString() << std::endl;
+        }
+    }
+    FrameArena::endFrame();
+    return result;
+}
+
+int runTileWorker(const QString& address, int delayMs, int threads) {
+    if (threads > 0) ThreadPool::setInstanceWorkerCount(threads);
+
+    const int colon = address.lastIndexOf(':');
+    const QString host = address.left(colon);
+    const quint16 port = address.mid(colon + 1).toUShort();
+
+    QTcpSocket socket;
+    socket.connectToHost(host, port);
+    if (colon < 0 || !socket.waitForConnected(10000)) {
+        std::cerr << "Worker: cannot connect to " << address.toStdString() << std::endl;
+        return 1;
+    }
+
+    ObjLoader mesh;
+    RayTracer tracer(mesh);
+    int width = 0;
+    int height = 0;
+    bool hasScene = false;
+    int exitCode = 0;
+    QEventLoop loop;
+
+    QObject::connect(&socket, &QTcpSocket::readyRead, [&] {
+        MessageType type;
+        QByteArray payload;
+        while (takeMessage(&socket, type, payload)) {
+            if (type == MessageType::Scene) {
+                hasScene = deserializeScene(payload, mesh, tracer, width, height);
+                if (!hasScene) {
+                    std::cerr << "Worker: invalid scene" << std::endl;
+                    exitCode = 1;
+                    loop.quit();
+                    return;
+                }
+            } else if (type == MessageType::Tile && hasScene) {
+                QDataStream in(payload);
+                qint32 id, x, y, w, h;
+                in >> id >> x >> y >> w >> h;
+                if (w <= 0 || h <= 0 || x < 0 || y < 0 || x + w > width || y + h > height) continue;
+
+                GBuffer tile;
+                tile.allocate(FrameArena::local(), w, h);
+                auto start = Clock::now();
+                tracer.traceRegion(tile, x, y, width, height);
+                double traceMs = elapsedMs(start);
+                if (delayMs > 0) QThread::msleep(delayMs);
+
+                sendMessage(&socket, MessageType::TileResult, encodeTileResult(id, traceMs, tile));
+                FrameArena::endFrame();
+            }
+        }
+    });
+    QObject::connect(&socket, &QTcpSocket::disconnected, &loop, &QEventLoop::quit);
+
+    loop.exec();
+    return exitCode;
+}
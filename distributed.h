@@ -0,0 +1,40 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <QString>
+
+// 분산 타일 렌더링 (레이 트레이서 전용)
+// - 코디네이터: 장면(메쉬, 인스턴스 변환, 광원, 카메라, 트레이서 설정)을 한 번 직렬화해서
+//   접속한 워커마다 보내고, 타일을 나눠 준 뒤 결과(G-buffer 타일)를 모아 디노이즈 → 저장
+// - 느린 타일은 다른 워커에 다시 맡기고 (먼저 온 결과 사용), 끊긴 워커의 타일은 회수
+// - 워커: 같은 실행 파일을 --worker host:port로 실행 (로컬 워커는 코디네이터가 직접 띄움)
+// 픽셀 난수는 전체 이미지 좌표 기준이라 결과는 한 머신에서 그린 것과 같음
+struct DistributedOptions {
+    QString outputPath;
+    QString cowPath;
+    int width = 1920;
+    int height = 1080;
+    int samplesPerPixel = 1;
+    int tileSize = 64;
+    QString host = "127.0.0.1";   // 대기 주소 (원격 워커를 받으려면 0.0.0.0)
+    int port = 0;                 // 0이면 자동
+    int localWorkers = 4;         // 이 머신에서 띄울 워커 프로세스 수 (0이면 외부 워커만)
+    int tilesInFlight = 2;        // 워커당 동시에 맡기는 타일 수 (전송 중에도 계산하도록)
+    double slowTileFactor = 4.0;  // 평균 타일 시간의 이 배수를 넘으면 재할당
+    int minReassignMs = 5000;     // 재할당 최소 대기 시간
+    int connectTimeoutMs = 30000; // 이 시간 동안 살아 있는 워커가 없으면 실패
+
+    // 장애 테스트용
+    int slowWorkers = 0;          // 처음 k개 로컬 워커는 타일마다 slowWorkerDelayMs 지연
+    int slowWorkerDelayMs = 8000; // minReassignMs보다 길어야 재할당이 일어남
+    int killWorkerAfterTiles = 0; // 완료 타일이 이 수가 되면 워커 하나의 연결을 끊음
+};
+
+// 0: 성공, 1: 실패
+int runDistributedRender(const DistributedOptions& options);
+
+// address = "host:port", delayMs는 타일마다 추가 지연 (테스트용)
+// threads > 0이면 이 워커의 스레드 풀 크기 (로컬 워커는 코어를 나눠 가짐)
+int runTileWorker(const QString& address, int delayMs, int threads = 0);
+
+#endif // DISTRIBUTED_H
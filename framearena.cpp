@@ -0,0 +1,163 @@
+#include "framearena.h"
+
+#include <atomic>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+// === 힙 할당 카운터 ===
+// FRAME_ARENA_COUNT_ALLOCATIONS 빌드(CMake 옵션, 프로파일링용)에서만 전역 operator new를 대체해서
+// 호출 횟수를 센다 (프레임당 할당 수 리포트용). 기본 빌드는 표준 할당기를 그대로 씀
+#ifdef FRAME_ARENA_COUNT_ALLOCATIONS
+static std::atomic<size_t> heapAllocations{0};
+
+static void* countedAllocate(std::size_t size) noexcept {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+// 정렬 할당: 앞쪽에 원래 포인터를 남겨 두고 정렬된 주소를 돌려줌
+static void* countedAllocateAligned(std::size_t size, std::align_val_t alignment) noexcept {
+    const std::size_t align = std::max(static_cast<std::size_t>(alignment), sizeof(void*));
+    void* raw = countedAllocate(size + align + sizeof(void*));
+    if (!raw) return nullptr;
+    std::uintptr_t aligned = (reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*) + align - 1) & ~(std::uintptr_t(align) - 1);
+    reinterpret_cast<void**>(aligned)[-1] = raw;
+    return reinterpret_cast<void*>(aligned);
+}
+
+static void freeAligned(void* p) noexcept {
+    if (p) std::free(reinterpret_cast<void**>(p)[-1]);
+}
+
+void* operator new(std::size_t size) {
+    if (void* p = countedAllocate(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+    if (void* p = countedAllocate(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return countedAllocate(size); }
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* p = countedAllocateAligned(size, alignment)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    if (void* p = countedAllocateAligned(size, alignment)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAllocateAligned(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return countedAllocateAligned(size, alignment);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+void operator delete(void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { freeAligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { freeAligned(p); }
+
+bool FrameArena::countsHeapAllocations() { return true; }
+
+size_t FrameArena::heapAllocationCount() {
+    return heapAllocations.load(std::memory_order_relaxed);
+}
+#else
+bool FrameArena::countsHeapAllocations() { return false; }
+
+size_t FrameArena::heapAllocationCount() { return 0; }
+#endif
+
+// === 스레드별 아레나 등록 ===
+static std::mutex& registryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::vector<FrameArena*>& registry() {
+    static std::vector<FrameArena*> arenas;
+    return arenas;
+}
+
+FrameArena::FrameArena(size_t initialCapacity)
+    : buffer(static_cast<char*>(::operator new(initialCapacity))), size(initialCapacity)
+{
+}
+
+FrameArena::~FrameArena() {
+    for (void* block : overflow) ::operator delete(block);
+    ::operator delete(buffer);
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment) {
+    assert(alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__ && (alignment & (alignment - 1)) == 0);
+
+    size_t offset = (used + alignment - 1) & ~(alignment - 1);
+    if (offset + bytes <= size) {
+        used = offset + bytes;
+        return buffer + offset;
+    }
+
+    // 용량 초과: 이번 프레임만 별도 블록 사용
+    void* block = ::operator new(bytes ? bytes : 1);
+    overflow.push_back(block);
+    overflowBytes += bytes;
+    return block;
+}
+
+void FrameArena::reset() {
+    if (!overflow.empty()) {
+        // 다음 프레임부터는 한 블록에 다 들어가도록 키움
+        size_t needed = used + overflowBytes + overflow.size() * alignof(std::max_align_t);
+        for (void* block : overflow) ::operator delete(block);
+        overflow.clear();
+        overflowBytes = 0;
+
+        ::operator delete(buffer);
+        size = std::max(size * 2, needed);
+        buffer = static_cast<char*>(::operator new(size));
+    }
+    used = 0;
+}
+
+namespace {
+struct ThreadArena {
+    FrameArena arena;
+
+    ThreadArena() {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        registry().push_back(&arena);
+    }
+    ~ThreadArena() {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        auto& arenas = registry();
+        arenas.erase(std::remove(arenas.begin(), arenas.end(), &arena), arenas.end());
+    }
+};
+}
+
+FrameArena& FrameArena::local() {
+    thread_local ThreadArena threadArena;
+    return threadArena.arena;
+}
+
+void FrameArena::endFrame() {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    for (FrameArena* arena : registry()) arena->reset();
+}
@@ -0,0 +1,76 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <cstddef>
+#include <vector>
+#include <type_traits>
+
+// 프레임 단위 bump 할당기
+// - allocate()는 포인터만 증가시키고, 해제는 프레임 끝 reset()에서 한 번에
+// - 용량을 넘으면 그 프레임만 별도 블록을 쓰고 reset() 때 버퍼를 키움
+//   → 워밍업 이후(steady state)에는 힙 할당 0회
+class FrameArena {
+public:
+    explicit FrameArena(size_t initialCapacity = 1 << 20);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    template<typename T>
+    T* allocateArray(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena does not run destructors");
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    void reset();
+
+    size_t bytesUsed() const { return used + overflowBytes; }
+    size_t capacity() const { return size; }
+
+    // 현재 스레드의 아레나 (메인 스레드와 워커 스레드가 각자 하나씩)
+    static FrameArena& local();
+
+    // 프레임 끝: 등록된 모든 스레드의 아레나를 리셋 (워커가 쉬는 동안 호출)
+    static void endFrame();
+
+    // 프로그램 시작 이후 operator new 호출 횟수
+    // FRAME_ARENA_COUNT_ALLOCATIONS 빌드에서만 셈 (아니면 countsHeapAllocations()가 false, 항상 0)
+    static bool countsHeapAllocations();
+    static size_t heapAllocationCount();
+
+private:
+    char* buffer = nullptr;
+    size_t size = 0;
+    size_t used = 0;
+
+    std::vector<void*> overflow;
+    size_t overflowBytes = 0;
+};
+
+// std 컨테이너용 어댑터: 프레임 임시 벡터를 아레나에서 할당
+template<typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    FrameArena* arena;
+
+    explicit ArenaAllocator(FrameArena& arena) : arena(&arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(arena->allocate(sizeof(T) * n, alignof(T))); }
+    void deallocate(T*, size_t) {} // reset()에서 일괄 해제
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+template<typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif // FRAMEARENA_H
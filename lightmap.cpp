@@ -0,0 +1,335 @@
+#include "lightmap.h"
+#include "framearena.h"
+#include "raytracer.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// 층마다 다른 텍셀 난수 (같은 광원 위치면 다시 구워도 같은 값)
+uint32_t layerSeed(const QVector3D& position) {
+    uint32_t bits[3];
+    const float coords[3] = { position.x(), position.y(), position.z() };
+    std::memcpy(bits, coords, sizeof(bits));
+    return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+}
+
+} // namespace
+
+// 인스턴스 박스에 가려질 수 있는 바닥 점의 xz 박스
+// 바닥 점 p, 광원 점 q, 박스 점 b가 한 직선 위면 p = q + (b - q) * (q.y + 1) / (q.y - b.y).
+// q가 b보다 위에 있는 한 p의 x, z는 q, b의 각 좌표에 대해 단조라서 두 박스의 꼭짓점만 투영하면 됨
+Lightmap::Footprint Lightmap::footprint(const RayTracer& tracer, const QVector3D& light, const QMatrix4x4& transform) const {
+    const float inf = std::numeric_limits<float>::max();
+    QVector3D boxMin, boxMax;
+    tracer.worldBounds(transform, boxMin, boxMax);
+    // 섀도우 레이 시작 오프셋(0.01)과 반올림 오차만큼 넓힘, 바닥 아래는 바닥 → 광원 선분이 지나지 않음
+    boxMin -= QVector3D(0.02f, 0.02f, 0.02f);
+    boxMax += QVector3D(0.02f, 0.02f, 0.02f);
+    if (boxMax.y() < -1.0f) return { inf, inf, -inf, -inf };
+    boxMin.setY(std::max(boxMin.y(), -1.0f));
+
+    const float radius = std::max(0.0f, lightRadius);
+    const QVector3D lightMin = light - QVector3D(radius, radius, radius);
+    const QVector3D lightMax = light + QVector3D(radius, radius, radius);
+    if (lightMin.y() <= boxMax.y()) return { -inf, -inf, inf, inf }; // 광원이 박스 위에 있지 않으면 어디든
+
+    Footprint result{ inf, inf, -inf, -inf };
+    for (int lightCorner = 0; lightCorner < 8; ++lightCorner) {
+        const QVector3D q(lightCorner & 1 ? lightMax.x() : lightMin.x(), lightCorner & 2 ? lightMax.y() : lightMin.y(),
+                          lightCorner & 4 ? lightMax.z() : lightMin.z());
+        for (int boxCorner = 0; boxCorner < 8; ++boxCorner) {
+            const QVector3D b(boxCorner & 1 ? boxMax.x() : boxMin.x(), boxCorner & 2 ? boxMax.y() : boxMin.y(),
+                              boxCorner & 4 ? boxMax.z() : boxMin.z());
+            const float t = (q.y() + 1.0f) / (q.y() - b.y());
+            const float x = q.x() + (b.x() - q.x()) * t;
+            const float z = q.z() + (b.z() - q.z()) * t;
+            result.minX = std::min(result.minX, x);
+            result.maxX = std::max(result.maxX, x);
+            result.minZ = std::min(result.minZ, z);
+            result.maxZ = std::max(result.maxZ, z);
+        }
+    }
+    result.minX -= 1e-3f;
+    result.minZ -= 1e-3f;
+    result.maxX += 1e-3f;
+    result.maxZ += 1e-3f;
+    return result;
+}
+
+Lightmap::Stats Lightmap::update(const RayTracer& tracer, float texelsPerUnit, int samplesPerTexel) {
+    using Clock = std::chrono::steady_clock;
+    Stats stats;
+    auto start = Clock::now();
+
+    const std::vector<RayTracer::Instance>& instances = tracer.instances();
+    const std::vector<RayTracer::Light>& lights = tracer.lights();
+    const int n = std::max(1, int(std::ceil(20.0f * texelsPerUnit)));
+    const bool layered = int(lights.size()) <= tracer.exhaustiveLightLimit;
+    // 확률적 요소가 없으면 샘플 하나로 충분
+    const bool stochastic = (tracer.shadows && tracer.lightRadius > 0.0f) || !layered;
+    const int spt = stochastic ? std::max(1, samplesPerTexel) : 1;
+
+    std::vector<QVector3D> positions(lights.size());
+    std::vector<QVector3D> colors(lights.size());
+    for (size_t i = 0; i < lights.size(); ++i) {
+        positions[i] = lights[i].position;
+        colors[i] = lights[i].color;
+    }
+    const bool lightsChanged = positions != lightPositions || colors != lightColors;
+
+    bool full = !valid || n != resolution || lightRadius != tracer.lightRadius || shadows != tracer.shadows ||
+                exhaustiveLightLimit != tracer.exhaustiveLightLimit || samples != spt ||
+                transforms.size() != instances.size() || perLight != layered || (!layered && lightsChanged);
+
+    // 움직인 인스턴스 (이전 변환은 아래에서 덮어쓰기 전에 씀)
+    std::vector<int> moved;
+    for (size_t k = 0; k < instances.size() && !full; ++k) {
+        if (instances[k].transform != transforms[k]) moved.push_back(int(k));
+    }
+    if (!full && moved.empty() && !lightsChanged) return stats;
+
+    resolution = n;
+    lightRadius = tracer.lightRadius;
+    shadows = tracer.shadows;
+    exhaustiveLightLimit = tracer.exhaustiveLightLimit;
+    samples = spt;
+    perLight = layered;
+    deterministic = !stochastic;
+    valid = true;
+
+    const int tilesPerSide = (n + kTileSize - 1) / kTileSize;
+    const float size = 20.0f / float(n);
+    std::atomic<int> bakedTexels{0};
+    std::atomic<int> bakedTiles{0};
+    auto texelCenter = [&](int x, int z) {
+        return QVector3D(-10.0f + (x + 0.5f) * size, -1.0f, -10.0f + (z + 0.5f) * size);
+    };
+
+    if (layered) {
+        // 광원 위치가 같은 층은 다시 쓰고, 새 광원만 새 층 (색은 combine()에서)
+        std::vector<Layer> next(lights.size());
+        std::vector<char> fresh(lights.size(), 1);
+        std::vector<char> used(layers.size(), 0);
+        for (size_t i = 0; i < lights.size() && !full; ++i) {
+            for (size_t j = 0; j < layers.size(); ++j) {
+                if (used[j] || layers[j].position != positions[i]) continue;
+                next[i] = std::move(layers[j]);
+                used[j] = 1;
+                fresh[i] = 0;
+                break;
+            }
+        }
+
+        // 층마다 다시 구울 xz 박스: 새 층은 발자국 전체, 기존 층은 움직인 인스턴스의 이전 ∪ 새 발자국
+        std::vector<std::vector<Footprint>> dirty(lights.size());
+        for (size_t i = 0; i < lights.size(); ++i) {
+            Layer& layer = next[i];
+            std::vector<Footprint> footprints;
+            if (shadows) {
+                for (size_t k = 0; k < instances.size(); ++k) {
+                    footprints.push_back(footprint(tracer, positions[i], instances[k].transform));
+                }
+            }
+            if (fresh[i]) {
+                layer.position = positions[i];
+                // 하드 섀도우는 발자국 안을 조회 때 추적하므로 가시성을 굽지 않음
+                if (!deterministic) {
+                    layer.visibility.assign(size_t(n) * n, 1.0f);
+                    dirty[i] = footprints;
+                }
+            } else if (!deterministic) {
+                for (int k : moved) {
+                    if (size_t(k) < layer.footprints.size()) dirty[i].push_back(layer.footprints[k]);
+                    if (size_t(k) < footprints.size()) dirty[i].push_back(footprints[k]);
+                }
+            }
+            layer.footprints = std::move(footprints);
+        }
+        layers = std::move(next);
+
+        ThreadPool::instance().parallelFor(tilesPerSide * tilesPerSide, [&](int tile, int) {
+            const int x0 = (tile % tilesPerSide) * kTileSize;
+            const int z0 = (tile / tilesPerSide) * kTileSize;
+            const int x1 = std::min(n, x0 + kTileSize);
+            const int z1 = std::min(n, z0 + kTileSize);
+            const QVector3D tileMin = texelCenter(x0, z0);
+            const QVector3D tileMax = texelCenter(x1 - 1, z1 - 1);
+
+            int baked = 0;
+            for (size_t l = 0; l < layers.size(); ++l) {
+                const std::vector<Footprint>& rects = dirty[l];
+                const bool touched = std::any_of(rects.begin(), rects.end(), [&](const Footprint& r) {
+                    return r.minX <= tileMax.x() && r.maxX >= tileMin.x() && r.minZ <= tileMax.z() && r.maxZ >= tileMin.z();
+                });
+                if (!touched) continue;
+
+                Layer& layer = layers[l];
+                const uint32_t seed = layerSeed(layer.position);
+                for (int z = z0; z < z1; ++z) {
+                    for (int x = x0; x < x1; ++x) {
+                        const QVector3D point = texelCenter(x, z);
+                        auto inside = [&](const Footprint& r) { return r.contains(point.x(), point.z()); };
+                        if (std::none_of(rects.begin(), rects.end(), inside)) continue;
+
+                        const size_t i = size_t(z) * n + x;
+                        if (std::none_of(layer.footprints.begin(), layer.footprints.end(), inside)) {
+                            layer.visibility[i] = 1.0f; // 가려질 수 없음
+                            continue;
+                        }
+                        RayTracer::Rng rng{uint32_t(i) * 0x9E3779B9u + seed};
+                        int visible = 0;
+                        for (int s = 0; s < spt; ++s) {
+                            visible += tracer.isInShadow(point, tracer.sampleLight(layer.position, rng)) ? 0 : 1;
+                        }
+                        layer.visibility[i] = float(visible) / float(spt);
+                        baked++;
+                    }
+                }
+            }
+            bakedTexels.fetch_add(baked, std::memory_order_relaxed);
+            if (baked) bakedTiles.fetch_add(1, std::memory_order_relaxed);
+        });
+
+        lightPositions = positions;
+        lightColors = colors;
+        combine();
+    } else {
+        layers.clear();
+        lightPositions = positions;
+        lightColors = colors;
+        unshadowed = QVector3D(0.0f, 0.0f, 0.0f);
+
+        // 움직인 인스턴스마다 이전 ∪ 새 월드 바운딩 박스 (lo, hi 쌍, 광원 반지름만큼 넓힘)
+        FrameArena& arena = FrameArena::local();
+        QVector3D* bounds = arena.allocateArray<QVector3D>(moved.size() * 2);
+        const int boundsCount = int(moved.size());
+        const float grow = 1e-3f + (shadows ? lightRadius : 0.0f);
+        for (int m = 0; m < boundsCount; ++m) {
+            QVector3D oldMin, oldMax, newMin, newMax;
+            tracer.worldBounds(transforms[moved[m]], oldMin, oldMax);
+            tracer.worldBounds(instances[moved[m]].transform, newMin, newMax);
+            bounds[2 * m] = QVector3D(std::min(oldMin.x(), newMin.x()), std::min(oldMin.y(), newMin.y()),
+                                      std::min(oldMin.z(), newMin.z())) - QVector3D(grow, grow, grow);
+            bounds[2 * m + 1] = QVector3D(std::max(oldMax.x(), newMax.x()), std::max(oldMax.y(), newMax.y()),
+                                          std::max(oldMax.z(), newMax.z())) + QVector3D(grow, grow, grow);
+        }
+        if (full) texels.assign(size_t(n) * n, QVector3D(0.0f, 0.0f, 0.0f));
+
+        // 광원에 닿는 선분이 바뀐 박스를 지날 수 있는지 (그림자를 끄면 인스턴스와 무관)
+        auto affected = [&](const QVector3D& lo, const QVector3D& hi) {
+            if (!shadows) return false;
+            for (int k = 0; k < boundsCount; ++k) {
+                for (const RayTracer::Light& light : lights) {
+                    // 타일 ∪ 광원의 박스 (선분은 모두 그 안에 있음)
+                    QVector3D spanMin(std::min(lo.x(), light.position.x()), std::min(lo.y(), light.position.y()), std::min(lo.z(), light.position.z()));
+                    QVector3D spanMax(std::max(hi.x(), light.position.x()), std::max(hi.y(), light.position.y()), std::max(hi.z(), light.position.z()));
+                    const QVector3D& boxMin = bounds[2 * k];
+                    const QVector3D& boxMax = bounds[2 * k + 1];
+                    if (spanMin.x() <= boxMax.x() && spanMax.x() >= boxMin.x() && spanMin.y() <= boxMax.y() &&
+                        spanMax.y() >= boxMin.y() && spanMin.z() <= boxMax.z() && spanMax.z() >= boxMin.z()) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+        auto texelAffected = [&](const QVector3D& point) {
+            for (int k = 0; k < boundsCount; ++k) {
+                for (const RayTracer::Light& light : lights) {
+                    RayTracer::Ray shadow{ point, light.position - point };
+                    if (RayTracer::intersectBounds(shadow, bounds[2 * k], bounds[2 * k + 1], 1.0f)) return true;
+                }
+            }
+            return false;
+        };
+
+        ThreadPool::instance().parallelFor(tilesPerSide * tilesPerSide, [&](int tile, int) {
+            const int x0 = (tile % tilesPerSide) * kTileSize;
+            const int z0 = (tile / tilesPerSide) * kTileSize;
+            const int x1 = std::min(n, x0 + kTileSize);
+            const int z1 = std::min(n, z0 + kTileSize);
+            if (!full && !affected(texelCenter(x0, z0), texelCenter(x1 - 1, z1 - 1))) return;
+
+            int baked = 0;
+            for (int z = z0; z < z1; ++z) {
+                for (int x = x0; x < x1; ++x) {
+                    RayTracer::HitInfo hit;
+                    hit.hit = true;
+                    hit.objectId = 0;
+                    hit.distance = 0.0f;
+                    hit.position = texelCenter(x, z);
+                    hit.normal = QVector3D(0.0f, 1.0f, 0.0f);
+                    if (!full && !texelAffected(hit.position)) continue;
+
+                    const size_t i = size_t(z) * n + x;
+                    RayTracer::Rng rng{uint32_t(i)};
+                    QVector3D sum(0.0f, 0.0f, 0.0f);
+                    for (int s = 0; s < spt; ++s) sum += tracer.directLight(hit, rng);
+                    texels[i] = sum / float(spt);
+                    baked++;
+                }
+            }
+            bakedTexels.fetch_add(baked, std::memory_order_relaxed);
+            if (baked) bakedTiles.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+
+    transforms.resize(instances.size());
+    for (size_t k = 0; k < instances.size(); ++k) transforms[k] = instances[k].transform;
+
+    stats.bakedTexels = bakedTexels.load();
+    stats.bakedTiles = bakedTiles.load();
+    stats.bakeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return stats;
+}
+
+// 광원 층 가시성 × 광원 색의 합 (directLight()와 같은 순서로 더함)
+void Lightmap::combine() {
+    unshadowed = QVector3D(0.0f, 0.0f, 0.0f);
+    for (const QVector3D& color : lightColors) unshadowed += color;
+    if (deterministic) return; // 층이 비어 있음
+
+    texels.assign(size_t(resolution) * resolution, QVector3D(0.0f, 0.0f, 0.0f));
+    for (size_t l = 0; l < layers.size(); ++l) {
+        const QVector3D color = lightColors[l];
+        const float* visibility = layers[l].visibility.data();
+        for (size_t i = 0; i < texels.size(); ++i) texels[i] += visibility[i] * color;
+    }
+}
+
+// 발자국 밖은 그림자 없는 값, 안은 텍셀 중심 사이 bilinear (바깥은 가장자리 텍셀)
+bool Lightmap::lookup(const QVector3D& position, QVector3D& result) const {
+    if (perLight) {
+        auto occludable = [&](const Layer& layer) {
+            return std::any_of(layer.footprints.begin(), layer.footprints.end(),
+                               [&](const Footprint& f) { return f.contains(position.x(), position.z()); });
+        };
+        if (std::none_of(layers.begin(), layers.end(), occludable)) {
+            result = unshadowed;
+            return true;
+        }
+        if (deterministic) return false;
+    }
+
+    const float scale = float(resolution) / 20.0f;
+    const float u = std::clamp((position.x() + 10.0f) * scale - 0.5f, 0.0f, float(resolution - 1));
+    const float v = std::clamp((position.z() + 10.0f) * scale - 0.5f, 0.0f, float(resolution - 1));
+    const int x0 = int(u);
+    const int z0 = int(v);
+    const int x1 = std::min(x0 + 1, resolution - 1);
+    const int z1 = std::min(z0 + 1, resolution - 1);
+    const float fx = u - float(x0);
+    const float fz = v - float(z0);
+
+    const QVector3D* row0 = texels.data() + size_t(z0) * resolution;
+    const QVector3D* row1 = texels.data() + size_t(z1) * resolution;
+    result = (row0[x0] * (1.0f - fx) + row0[x1] * fx) * (1.0f - fz) + (row1[x0] * (1.0f - fx) + row1[x1] * fx) * fz;
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef LIGHTMAP_H
+#define LIGHTMAP_H
+
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <vector>
+
+class RayTracer;
+
+// 정적 바닥(y = -1, |x|, |z| <= 10)의 직접광 캐시 (텍스처 공간)
+// - 광원 × 인스턴스마다 그림자가 질 수 있는 바닥 영역(그림자 발자국)을 보수적으로 구함:
+//   인스턴스 바운딩 박스 꼭짓점을 광원(구형 광원이면 그 박스의 꼭짓점)에서 바닥에 투영한 xz 박스
+//   발자국 밖은 가려질 수 없으므로 그림자 없는 직접광을 그대로 돌려줌 (텍셀 해상도와 무관하게 정확)
+// - 점광원 하드 섀도우는 발자국 안이면 호출자가 그 점에서 섀도우 레이를 쏨 → 텍셀보다 얇은 그림자도 남음
+// - 확률적 직접광은 광원마다 텍셀 가시성(samples개 평균)을 구워 두고 색을 곱해 더한 값을 bilinear로 조회
+//   발자국 안의 텍셀만 추적하고, 16x16 텍셀 타일 단위로 스레드 풀에서 병렬로 굽기
+// - 광원 하나를 켜고 끄면 그 광원의 층만 굽거나 버림. 색만 바뀌면 다시 더하기만.
+//   인스턴스가 움직이면 층마다 이전 ∪ 새 발자국 안의 텍셀만 다시 굽기
+// - 광원이 exhaustiveLightLimit보다 많으면(light BVH 샘플링) 층 없이 텍셀마다 directLight() 평균을 굽고,
+//   광원이 바뀌면 전체, 인스턴스가 움직이면 바뀐 박스가 텍셀 → 광원 선분에 걸리는 텍셀만 다시 굽기
+// 벽은 트레이서에 없어서 바닥만
+class Lightmap {
+public:
+    struct Stats {
+        int bakedTexels = 0; // 광원 층마다 센 텍셀 수
+        int bakedTiles = 0;
+        double bakeMs = 0.0;
+    };
+
+    // 트레이서 상태에 맞게 갱신 (메인 스레드, 추적 전에). 바뀐 것이 없으면 바로 반환
+    Stats update(const RayTracer& tracer, float texelsPerUnit, int samples);
+    // 메쉬를 바꿨을 때 (인스턴스 변환만으로는 알 수 없음)
+    void invalidate() { valid = false; }
+
+    bool ready() const { return valid; }
+    float texelSize() const { return 20.0f / float(resolution); }
+    // false면 하드 섀도우가 질 수 있는 점이라 직접 추적해야 함 (result는 그대로)
+    bool lookup(const QVector3D& position, QVector3D& result) const;
+
+private:
+    static const int kTileSize = 16;
+
+    // 바닥 위 xz 박스
+    struct Footprint {
+        float minX, minZ, maxX, maxZ;
+        bool contains(float x, float z) const { return x >= minX && x <= maxX && z >= minZ && z <= maxZ; }
+    };
+
+    // 광원 하나의 텍셀 가시성 [0, 1] (광원 위치로 구분, 색은 combine()에서만)
+    struct Layer {
+        QVector3D position;
+        std::vector<float> visibility;
+        std::vector<Footprint> footprints; // 인스턴스마다
+    };
+
+    Footprint footprint(const RayTracer& tracer, const QVector3D& light, const QMatrix4x4& transform) const;
+    void combine(); // 층 × 광원 색 → texels
+
+    bool valid = false;
+    int resolution = 0; // 한 변의 텍셀 수
+    std::vector<QVector3D> texels; // 조회용 직접광 (층 × 색의 합, 또는 샘플링 모드에서 구운 값)
+    std::vector<Layer> layers;     // 광원별 (광원 수 <= exhaustiveLightLimit일 때만)
+    QVector3D unshadowed;          // 그림자 없는 바닥 직접광 (광원 색의 합)
+
+    // 구울 때의 설정 (바뀌면 전체 다시 굽기)
+    float lightRadius = 0.0f;
+    bool shadows = false;
+    int exhaustiveLightLimit = 0;
+    int samples = 0;
+    bool perLight = false;
+    bool deterministic = false; // 확률적 요소가 없음 (하드 섀도우)
+    std::vector<QMatrix4x4> transforms;
+    std::vector<QVector3D> lightPositions;
+    std::vector<QVector3D> lightColors;
+};
+
+#endif // LIGHTMAP_H
@@ -1,16 +1,132 @@
 #include <QApplication>
 #include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QStringList>
+#include <QSurfaceFormat>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
 #include "openglwindow.h"
+#include "regression.h"
+#include "distributed.h"
 
 int main(int argc, char *argv[]) {
+    // 회귀 테스트/분산 렌더링은 화면 없이 실행 (QApplication 생성 전에 플랫폼 지정)
+    bool headless = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--regression") == 0 || std::strcmp(argv[i], "--render-distributed") == 0 ||
+            std::strcmp(argv[i], "--worker") == 0 || std::strcmp(argv[i], "--convert-obj") == 0) {
+            headless = true;
+        }
+    }
+    if (headless && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    // GLSL 330 + uniform block 사용을 위해 코어 프로파일 요청 (macOS는 4.1까지 지원)
+    QSurfaceFormat format;
+    format.setVersion(4, 1);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+    QSurfaceFormat::setDefaultFormat(format);
+
     QApplication app(argc, argv);
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption regressionOption("regression", "Run the headless performance/image regression harness.");
+    QCommandLineOption baselineOption("baseline", "Directory with the committed golden images.", "dir", "regression");
+    QCommandLineOption cowOption("cow", "Path to the bundled cow.obj to include in the regression scenes.", "path");
+    QCommandLineOption localOption("local", "Directory for machine-local golden images and timings (default: --baseline).", "dir");
+    QCommandLineOption strictOption("strict", "Fail when a golden image is missing instead of recording it.");
+    QCommandLineOption updateOption("update", "Overwrite golden images and timing baselines.");
+    QCommandLineOption slowdownOption("max-slowdown", "Fail when a scene is more than this many percent slower.", "percent", "20");
+    QCommandLineOption repeatsOption("repeats", "Runs per scene (fastest is used).", "count", "3");
+    QCommandLineOption distributedOption("render-distributed", "Ray trace one still across worker processes and save it.", "output");
+    QCommandLineOption sizeOption("size", "Distributed render size.", "WxH", "1920x1080");
+    QCommandLineOption sppOption("spp", "Distributed render samples per pixel.", "count", "1");
+    QCommandLineOption tileOption("tile", "Distributed render tile size in pixels.", "pixels", "64");
+    QCommandLineOption workersOption("workers", "Local worker processes to spawn (0: wait for remote workers).", "count", "4");
+    QCommandLineOption listenOption("listen", "Coordinator listen address.", "host", "127.0.0.1");
+    QCommandLineOption portOption("port", "Coordinator port (0: any free port).", "port", "0");
+    QCommandLineOption slowWorkersOption("slow-workers", "Fault test: delay every tile on the first N local workers.", "count", "0");
+    QCommandLineOption dropWorkerOption("drop-worker-after", "Fault test: disconnect one worker after N finished tiles.", "tiles", "0");
+    QCommandLineOption workerOption("worker", "Run as a tile worker for the coordinator at host:port.", "address");
+    QCommandLineOption workerDelayOption("worker-delay", "Extra delay per tile in worker mode (testing).", "ms", "0");
+    QCommandLineOption workerThreadsOption("worker-threads", "Threads per worker process (0: all hardware threads).", "count", "0");
+    QCommandLineOption convertOption("convert-obj", "Convert an OBJ into the paged out-of-core layout given by --pages, then exit.", "obj");
+    QCommandLineOption pagesOption("pages", "Paged mesh file (output of --convert-obj, or the model to view).", "file");
+    QCommandLineOption pageTrianglesOption("page-triangles", "Triangles per page when converting.", "count", "16384");
+    QCommandLineOption budgetOption("memory-budget", "Resident budget for mesh pages (CPU and GPU caches each, and for sorting when converting).", "MB", "256");
+    QCommandLineOption verboseOption("verbose", "Print ray tracing timings and GL state changes every frame.");
+    QCommandLineOption lightmapOption("lightmap-density", "Floor lightmap texels per world unit (0: trace floor shadows per pixel).", "texels", "8");
+    parser.addOptions({ regressionOption, baselineOption, localOption, strictOption, cowOption, updateOption, slowdownOption, repeatsOption,
+                        distributedOption, sizeOption, sppOption, tileOption, workersOption, listenOption, portOption,
+                        slowWorkersOption, dropWorkerOption, workerOption, workerDelayOption, workerThreadsOption,
+                        convertOption, pagesOption, pageTrianglesOption, budgetOption,
+                        lightmapOption, verboseOption });
+    parser.process(app);
+
+    if (parser.isSet(convertOption)) {
+        if (!parser.isSet(pagesOption)) {
+            std::cerr << "--convert-obj needs --pages <output>" << std::endl;
+            return 1;
+        }
+        return PagedMesh::convert(parser.value(convertOption).toStdString(), parser.value(pagesOption).toStdString(),
+                                  parser.value(pageTrianglesOption).toInt(),
+                                  size_t(std::max(1, parser.value(budgetOption).toInt())) << 20) ? 0 : 1;
+    }
+
+    if (parser.isSet(workerOption)) {
+        return runTileWorker(parser.value(workerOption), parser.value(workerDelayOption).toInt(),
+                             parser.value(workerThreadsOption).toInt());
+    }
+
+    if (parser.isSet(distributedOption)) {
+        DistributedOptions options;
+        options.outputPath = parser.value(distributedOption);
+        options.cowPath = parser.value(cowOption);
+        const QStringList size = parser.value(sizeOption).split('x');
+        if (size.size() == 2) {
+            options.width = std::max(1, size[0].toInt());
+            options.height = std::max(1, size[1].toInt());
+        }
+        options.samplesPerPixel = std::max(1, parser.value(sppOption).toInt());
+        options.tileSize = parser.value(tileOption).toInt();
+        options.localWorkers = parser.value(workersOption).toInt();
+        options.host = parser.value(listenOption);
+        options.port = parser.value(portOption).toInt();
+        options.slowWorkers = parser.value(slowWorkersOption).toInt();
+        options.killWorkerAfterTiles = parser.value(dropWorkerOption).toInt();
+        return runDistributedRender(options);
+    }
+
+    if (parser.isSet(regressionOption)) {
+        RegressionOptions options;
+        options.baselineDir = parser.value(baselineOption);
+        options.localDir = parser.value(localOption);
+        options.strict = parser.isSet(strictOption);
+        options.cowPath = parser.value(cowOption);
+        options.update = parser.isSet(updateOption);
+        options.maxSlowdownPercent = parser.value(slowdownOption).toDouble();
+        options.repeats = parser.value(repeatsOption).toInt();
+        return runRegression(options);
+    }
+
     OpenGLWindow window;
     window.resize(800, 600);
+    window.setLightmapDensity(parser.value(lightmapOption).toFloat());
+    window.setVerbose(parser.isSet(verboseOption));
     window.show();
 
-    // QString objFilePath = QCoreApplication::applicationDirPath() + "/cow.obj";
-    window.loadModel("/Users/hwang-yoonseon/Desktop/konkuk/wsu/cg/assignment_3/cow.obj");
+    if (parser.isSet(pagesOption)) {
+        // 메모리보다 큰 메쉬: 페이지 단위로 읽고 내보냄
+        size_t budget = size_t(std::max(1, parser.value(budgetOption).toInt())) << 20;
+        window.loadPagedModel(parser.value(pagesOption).toStdString(), budget);
+    } else {
+        // QString objFilePath = QCoreApplication::applicationDirPath() + "/cow.obj";
+        window.loadModel("/Users/hwang-yoonseon/Desktop/konkuk/wsu/cg/assignment_3/cow.obj");
+    }
 
     return app.exec();
 }
@@ -0,0 +1,341 @@
+#include "meshtopology.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+
+namespace {
+
+const int CHUNK = 4096;      // 면/하프엣지/정점 병렬 처리 단위
+const int FRONTIER_CHUNK = 256;
+
+int chunkCount(int count, int chunk = CHUNK) {
+    return (count + chunk - 1) / chunk;
+}
+
+// [begin, end) 구간 단위로 병렬 실행
+template<typename Fn>
+void forChunks(int count, const Fn& fn, int chunk = CHUNK) {
+    ThreadPool::instance().parallelFor(chunkCount(count, chunk), [&](int c, int worker) {
+        fn(c * chunk, std::min(count, (c + 1) * chunk), worker);
+    });
+}
+
+template<typename T>
+std::unique_ptr<std::atomic<T>[]> atomicArray(int count, T value) {
+    std::unique_ptr<std::atomic<T>[]> array(new std::atomic<T>[size_t(std::max(count, 1))]);
+    forChunks(count, [&](int begin, int end, int) {
+        for (int i = begin; i < end; ++i) array[i].store(value, std::memory_order_relaxed);
+    });
+    return array;
+}
+
+// 락 없는 union-find (경로 절반 압축). 루트는 항상 더 작은 인덱스 쪽에 붙으므로 성분의 최소 면이 루트
+int findRoot(std::atomic<int>* parent, int x) {
+    while (true) {
+        int p = parent[x].load(std::memory_order_relaxed);
+        if (p == x) return x;
+        int grand = parent[p].load(std::memory_order_relaxed);
+        if (grand != p) parent[x].compare_exchange_weak(p, grand, std::memory_order_relaxed);
+        x = grand;
+    }
+}
+
+void unite(std::atomic<int>* parent, int a, int b) {
+    while (true) {
+        a = findRoot(parent, a);
+        b = findRoot(parent, b);
+        if (a == b) return;
+        if (a < b) std::swap(a, b);
+        int expected = a;
+        if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) return;
+    }
+}
+
+void atomicAdd(std::atomic<double>& target, double value) {
+    double current = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {}
+}
+
+// 뒤집힌 면 (a, b, c) → (c, b, a)의 하프엣지 대응
+// 같은 변: a→b ↔ b→a (0 ↔ 1), b→c ↔ c→b (1 ↔ 0), c→a ↔ a→c (2 ↔ 2)
+// 같은 시작 정점: a (0 → 2), b (1 → 1), c (2 → 0)
+const int SAME_EDGE[3] = { 1, 0, 2 };
+const int SAME_ORIGIN[3] = { 2, 1, 0 };
+
+} // namespace
+
+void MeshTopology::build(const std::vector<Vertex>& vertices, const std::vector<Face>& faces) {
+    const int faceTotal = int(faces.size());
+    const int vertexTotal = int(vertices.size());
+    const int halfEdgeTotal = faceTotal * 3;
+
+    // (1) 바운딩 박스: 구간별 최소/최대 → 합치기
+    const float inf = std::numeric_limits<float>::max();
+    std::vector<Vertex> chunkMin(size_t(chunkCount(vertexTotal)), Vertex{inf, inf, inf});
+    std::vector<Vertex> chunkMax(chunkMin.size(), Vertex{-inf, -inf, -inf});
+    forChunks(vertexTotal, [&](int begin, int end, int) {
+        Vertex& lo = chunkMin[begin / CHUNK];
+        Vertex& hi = chunkMax[begin / CHUNK];
+        for (int i = begin; i < end; ++i) {
+            const Vertex& v = vertices[i];
+            lo = { std::min(lo.x, v.x), std::min(lo.y, v.y), std::min(lo.z, v.z) };
+            hi = { std::max(hi.x, v.x), std::max(hi.y, v.y), std::max(hi.z, v.z) };
+        }
+    });
+    meshBoundsMin = vertexTotal ? Vertex{inf, inf, inf} : Vertex{0.0f, 0.0f, 0.0f};
+    meshBoundsMax = vertexTotal ? Vertex{-inf, -inf, -inf} : Vertex{0.0f, 0.0f, 0.0f};
+    for (size_t c = 0; c < chunkMin.size(); ++c) {
+        meshBoundsMin = { std::min(meshBoundsMin.x, chunkMin[c].x), std::min(meshBoundsMin.y, chunkMin[c].y), std::min(meshBoundsMin.z, chunkMin[c].z) };
+        meshBoundsMax = { std::max(meshBoundsMax.x, chunkMax[c].x), std::max(meshBoundsMax.y, chunkMax[c].y), std::max(meshBoundsMax.z, chunkMax[c].z) };
+    }
+
+    // (2) 하프엣지 시작 정점
+    origins.resize(size_t(halfEdgeTotal));
+    forChunks(faceTotal, [&](int begin, int end, int) {
+        for (int f = begin; f < end; ++f) {
+            origins[3 * f] = int(faces[f].v1);
+            origins[3 * f + 1] = int(faces[f].v2);
+            origins[3 * f + 2] = int(faces[f].v3);
+        }
+    });
+
+    // (3) 정점별 나가는 하프엣지 (개수 세기 → 누적합 → 채우기 → 정렬)
+    auto cursor = atomicArray<int>(vertexTotal, 0);
+    forChunks(halfEdgeTotal, [&](int begin, int end, int) {
+        for (int h = begin; h < end; ++h) cursor[origins[h]].fetch_add(1, std::memory_order_relaxed);
+    });
+    outgoingOffsets.assign(size_t(vertexTotal) + 1, 0);
+    for (int v = 0; v < vertexTotal; ++v) {
+        int count = cursor[v].load(std::memory_order_relaxed);
+        cursor[v].store(outgoingOffsets[v], std::memory_order_relaxed);
+        outgoingOffsets[v + 1] = outgoingOffsets[v] + count;
+    }
+    outgoingEdges.resize(size_t(halfEdgeTotal));
+    forChunks(halfEdgeTotal, [&](int begin, int end, int) {
+        for (int h = begin; h < end; ++h) outgoingEdges[cursor[origins[h]].fetch_add(1, std::memory_order_relaxed)] = h;
+    });
+    forChunks(vertexTotal, [&](int begin, int end, int) {
+        for (int v = begin; v < end; ++v) {
+            std::sort(outgoingEdges.begin() + outgoingOffsets[v], outgoingEdges.begin() + outgoingOffsets[v + 1]);
+        }
+    });
+
+    // (4) 같은 변을 쓰는 다른 면의 하프엣지 (방향 무관). a→b는 b의 b→a, a의 다른 a→b에서 찾음
+    mates.resize(size_t(halfEdgeTotal));
+    std::atomic<int> boundary{0};
+    std::atomic<int> nonManifold{0};
+    forChunks(halfEdgeTotal, [&](int begin, int end, int) {
+        int localBoundary = 0;
+        int localNonManifold = 0;
+        for (int h = begin; h < end; ++h) {
+            const int a = origins[h];
+            const int b = target(h);
+            mates[h] = -1;
+            if (a == b) continue; // 퇴화 삼각형
+
+            int found = -1;
+            int count = 0;
+            bool smallest = true;
+            for (int g : outgoing(b)) {
+                if (target(g) == a) { found = g; count++; smallest &= h < g; }
+            }
+            for (int g : outgoing(a)) {
+                if (g != h && target(g) == b) { found = g; count++; smallest &= h < g; }
+            }
+            if (count == 1) mates[h] = found;
+            else if (count == 0) localBoundary++;
+            else if (smallest) localNonManifold++; // 변마다 한 번만
+        }
+        boundary.fetch_add(localBoundary, std::memory_order_relaxed);
+        nonManifold.fetch_add(localNonManifold, std::memory_order_relaxed);
+    });
+    boundaryEdges = boundary.load();
+    nonManifoldEdges = nonManifold.load();
+    nonOrientableComponents = 0;
+
+    buildComponents();
+}
+
+// 짝이 있는 변으로 이어진 면끼리 같은 성분. 성분 번호는 최소 면 인덱스 순서
+void MeshTopology::buildComponents() {
+    const int faceTotal = faceCount();
+    const int halfEdgeTotal = faceTotal * 3;
+
+    std::unique_ptr<std::atomic<int>[]> parent(new std::atomic<int>[size_t(std::max(faceTotal, 1))]);
+    forChunks(faceTotal, [&](int begin, int end, int) {
+        for (int f = begin; f < end; ++f) parent[f].store(f, std::memory_order_relaxed);
+    });
+    forChunks(halfEdgeTotal, [&](int begin, int end, int) {
+        for (int h = begin; h < end; ++h) {
+            if (mates[h] > h) unite(parent.get(), face(h), face(mates[h]));
+        }
+    });
+
+    // 루트 → 성분 번호 (구간별 루트 수 → 누적합)
+    faceComponents.resize(size_t(faceTotal));
+    std::vector<int> chunkRoots(size_t(chunkCount(faceTotal)), 0);
+    forChunks(faceTotal, [&](int begin, int end, int) {
+        int roots = 0;
+        for (int f = begin; f < end; ++f) {
+            faceComponents[f] = findRoot(parent.get(), f);
+            roots += faceComponents[f] == f;
+        }
+        chunkRoots[begin / CHUNK] = roots;
+    });
+    components = 0;
+    for (int& roots : chunkRoots) {
+        int count = roots;
+        roots = components;
+        components += count;
+    }
+    std::vector<int> rootIds(faceComponents.size());
+    forChunks(faceTotal, [&](int begin, int end, int) {
+        int id = chunkRoots[begin / CHUNK];
+        for (int f = begin; f < end; ++f) {
+            if (faceComponents[f] == f) rootIds[f] = id++;
+        }
+    });
+    forChunks(faceTotal, [&](int begin, int end, int) {
+        for (int f = begin; f < end; ++f) faceComponents[f] = rootIds[faceComponents[f]];
+    });
+}
+
+int MeshTopology::orient(const std::vector<Vertex>& vertices, std::vector<Face>& faces) {
+    const int faceTotal = faceCount();
+    const int halfEdgeTotal = faceTotal * 3;
+    if (faceTotal == 0) return 0;
+
+    // (1) 성분마다 최소 면에서 시작하는 flood fill (모든 성분을 한꺼번에 단계별로 병렬 확장)
+    //     state: -1 미방문, 0 그대로, 1 뒤집기. 같은 방향으로 변을 쓰는 이웃은 반대 상태가 됨
+    auto state = atomicArray<int8_t>(faceTotal, -1);
+    auto conflict = atomicArray<uint8_t>(components, 0);
+    std::vector<int> frontier(faceComponents.size());
+    std::vector<int> nextFrontier(faceComponents.size());
+    int frontierSize = 0;
+    for (int f = 0, seen = 0; f < faceTotal && seen < components; ++f) {
+        if (faceComponents[f] == seen) {
+            state[f].store(0, std::memory_order_relaxed);
+            frontier[frontierSize++] = f;
+            seen++;
+        }
+    }
+
+    while (frontierSize > 0) {
+        std::atomic<int> nextSize{0};
+        forChunks(frontierSize, [&](int begin, int end, int) {
+            int found[3 * FRONTIER_CHUNK];
+            int foundCount = 0;
+            for (int i = begin; i < end; ++i) {
+                const int f = frontier[i];
+                const int8_t s = state[f].load(std::memory_order_relaxed);
+                for (int h = 3 * f; h < 3 * f + 3; ++h) {
+                    const int m = mates[h];
+                    if (m < 0) continue;
+                    const int8_t want = int8_t(s ^ int8_t(origins[m] == origins[h]));
+                    int8_t expected = -1;
+                    if (state[face(m)].compare_exchange_strong(expected, want, std::memory_order_relaxed)) {
+                        found[foundCount++] = face(m);
+                    } else if (expected != want) {
+                        conflict[faceComponents[f]].store(1, std::memory_order_relaxed); // 뫼비우스 띠 등
+                    }
+                }
+            }
+            int offset = nextSize.fetch_add(foundCount, std::memory_order_relaxed);
+            std::copy(found, found + foundCount, nextFrontier.begin() + offset);
+        }, FRONTIER_CHUNK);
+        std::swap(frontier, nextFrontier);
+        frontierSize = nextSize.load();
+    }
+
+    // (2) 성분별 부호 있는 부피 (메쉬 중심 기준). 음수면 안쪽을 향하므로 성분 전체를 뒤집음
+    //     같은 성분의 면은 보통 파일에서 연속이라 성분이 바뀔 때만 원자적으로 더함
+    const float cx = (meshBoundsMin.x + meshBoundsMax.x) * 0.5f;
+    const float cy = (meshBoundsMin.y + meshBoundsMax.y) * 0.5f;
+    const float cz = (meshBoundsMin.z + meshBoundsMax.z) * 0.5f;
+    auto volume = atomicArray<double>(components, 0.0);
+    forChunks(faceTotal, [&](int begin, int end, int) {
+        int current = faceComponents[begin];
+        double sum = 0.0;
+        for (int f = begin; f < end; ++f) {
+            if (faceComponents[f] != current) {
+                atomicAdd(volume[current], sum);
+                current = faceComponents[f];
+                sum = 0.0;
+            }
+            const Vertex& a = vertices[origins[3 * f]];
+            const Vertex& b = vertices[origins[3 * f + 1]];
+            const Vertex& c = vertices[origins[3 * f + 2]];
+            const double ax = a.x - cx, ay = a.y - cy, az = a.z - cz;
+            const double bx = b.x - cx, by = b.y - cy, bz = b.z - cz;
+            const double qx = c.x - cx, qy = c.y - cy, qz = c.z - cz;
+            double det = ax * (by * qz - bz * qy) - ay * (bx * qz - bz * qx) + az * (bx * qy - by * qx);
+            sum += state[f].load(std::memory_order_relaxed) ? -det : det;
+        }
+        atomicAdd(volume[current], sum);
+    });
+
+    nonOrientableComponents = 0;
+    for (int c = 0; c < components; ++c) nonOrientableComponents += conflict[c].load(std::memory_order_relaxed);
+
+    // (3) 면 뒤집기 + 인접 구조 갱신 (하프엣지 번호가 면 안에서 바뀜)
+    std::vector<uint8_t> flipped(faceComponents.size());
+    std::atomic<int> flippedCount{0};
+    forChunks(faceTotal, [&](int begin, int end, int) {
+        int count = 0;
+        for (int f = begin; f < end; ++f) {
+            const bool inward = volume[faceComponents[f]].load(std::memory_order_relaxed) < 0.0;
+            flipped[f] = uint8_t(state[f].load(std::memory_order_relaxed) != int8_t(inward));
+            if (!flipped[f]) continue;
+            std::swap(faces[f].v1, faces[f].v3);
+            std::swap(origins[3 * f], origins[3 * f + 2]);
+            count++;
+        }
+        flippedCount.fetch_add(count, std::memory_order_relaxed);
+    });
+    if (flippedCount.load() == 0) return 0;
+
+    auto remap = [&](int h, const int* table) {
+        return flipped[face(h)] ? h - h % 3 + table[h % 3] : h;
+    };
+    std::vector<int> remapped(mates.size());
+    forChunks(halfEdgeTotal, [&](int begin, int end, int) {
+        for (int h = begin; h < end; ++h) {
+            remapped[remap(h, SAME_EDGE)] = mates[h] < 0 ? -1 : remap(mates[h], SAME_EDGE);
+        }
+    });
+    mates.swap(remapped);
+    forChunks(vertexCount(), [&](int begin, int end, int) {
+        for (int v = begin; v < end; ++v) {
+            auto first = outgoingEdges.begin() + outgoingOffsets[v];
+            auto last = outgoingEdges.begin() + outgoingOffsets[v + 1];
+            for (auto it = first; it != last; ++it) *it = remap(*it, SAME_ORIGIN);
+            std::sort(first, last);
+        }
+    });
+    return flippedCount.load();
+}
+
+MeshTopology::Range MeshTopology::outgoing(int v) const {
+    const int* edges = outgoingEdges.data();
+    return { edges + outgoingOffsets[v], edges + outgoingOffsets[v + 1] };
+}
+
+void MeshTopology::faceNeighbors(int f, int neighbors[3]) const {
+    for (int k = 0; k < 3; ++k) {
+        int m = mates[3 * f + k];
+        neighbors[k] = m < 0 ? -1 : face(m);
+    }
+}
+
+void MeshTopology::vertexNeighbors(int v, std::vector<int>& out) const {
+    out.clear();
+    for (int h : outgoing(v)) {
+        out.push_back(target(h));
+        out.push_back(origin(prev(h))); // 경계 정점도 빠짐없이
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
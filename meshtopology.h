@@ -0,0 +1,78 @@
+#ifndef MESHTOPOLOGY_H
+#define MESHTOPOLOGY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "objloader.h"
+
+// 삼각형 메쉬의 하프엣지 인접 구조 (로딩 후 스레드 풀에서 병렬로 구성)
+// - 면 f의 하프엣지는 3f, 3f+1, 3f+2 (v1→v2, v2→v3, v3→v1)
+// - 정점마다 나가는 하프엣지 목록 (= 정점에 붙은 면 목록)을 CSR로 보관
+// - 같은 변을 공유하는 면이 정확히 둘일 때만 짝(mate)이 있음 (경계/비다양체 변은 -1)
+// 면 인덱스가 바뀌면(orient 제외) 다시 build() 해야 함
+class MeshTopology {
+public:
+    struct Range {
+        const int* first;
+        const int* last;
+        const int* begin() const { return first; }
+        const int* end() const { return last; }
+        int size() const { return int(last - first); }
+    };
+
+    void build(const std::vector<Vertex>& vertices, const std::vector<Face>& faces);
+
+    // 연결 성분마다 이웃 면과 감기 방향이 같도록 면을 뒤집고 (성분별 병렬 flood fill),
+    // 성분의 부호 있는 부피가 음수면 성분 전체를 뒤집어 바깥을 향하게 함. 뒤집은 면 수 반환
+    // faces는 build()에 넘긴 것과 같아야 하고, 인접 구조도 뒤집힌 면에 맞게 갱신됨
+    int orient(const std::vector<Vertex>& vertices, std::vector<Face>& faces);
+
+    int faceCount() const { return int(origins.size() / 3); }
+    int vertexCount() const { return int(outgoingOffsets.size()) - 1; }
+
+    static int face(int h) { return h / 3; }
+    static int next(int h) { return h % 3 == 2 ? h - 2 : h + 1; }
+    static int prev(int h) { return h % 3 == 0 ? h + 2 : h - 1; }
+    int origin(int h) const { return origins[h]; }
+    int target(int h) const { return origins[next(h)]; }
+
+    // 반대 방향 하프엣지 (경계, 비다양체, 방향이 어긋난 변은 -1)
+    int twin(int h) const {
+        int m = mates[h];
+        return m >= 0 && origins[m] != origins[h] ? m : -1;
+    }
+    bool isBoundary(int h) const { return mates[h] < 0; }
+
+    // 이웃 쿼리 (법선 생성, 단순화용)
+    Range outgoing(int v) const;
+    void faceNeighbors(int f, int neighbors[3]) const;         // 변을 공유하는 면, 없으면 -1
+    void vertexNeighbors(int v, std::vector<int>& out) const;  // 1-ring 정점 (중복 없이)
+
+    // 연결성
+    int componentCount() const { return components; }
+    int component(int f) const { return faceComponents[f]; }
+    int boundaryEdgeCount() const { return boundaryEdges; }
+    int nonManifoldEdgeCount() const { return nonManifoldEdges; }
+    int nonOrientableComponentCount() const { return nonOrientableComponents; }
+
+    const Vertex& boundsMin() const { return meshBoundsMin; }
+    const Vertex& boundsMax() const { return meshBoundsMax; }
+
+private:
+    void buildComponents();
+
+    std::vector<int> origins;          // 하프엣지 → 시작 정점
+    std::vector<int> mates;            // 하프엣지 → 같은 변의 다른 면 하프엣지
+    std::vector<int> outgoingOffsets;  // 정점 → outgoingEdges 범위 (vertexCount + 1)
+    std::vector<int> outgoingEdges;
+    std::vector<int> faceComponents;
+    int components = 0;
+    int boundaryEdges = 0;
+    int nonManifoldEdges = 0;
+    int nonOrientableComponents = 0;
+    Vertex meshBoundsMin{0.0f, 0.0f, 0.0f};
+    Vertex meshBoundsMax{0.0f, 0.0f, 0.0f};
+};
+
+#endif // MESHTOPOLOGY_H
@@ -1,110 +1,138 @@
 #include "objloader.h"
+#include "meshtopology.h"
+#include "threadpool.h"
 
-// 벡터 연산용 구조체
-struct Vec3 {
-    float x, y, z;
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 
-    Vec3() : x(0), y(0), z(0) {}  // 기본 생성자
-    Vec3(float x, float y, float z) : x(x), y(y), z(z) {}  // 명시적 생성자
-    Vec3(const Vertex& v) : x(v.x), y(v.y), z(v.z) {} // Vertex 변환 생성자
+namespace {
 
-    Vec3 operator-(const Vec3& v) const {
-        return {x - v.x, y - v.y, z - v.z};
-    }
-
-    Vec3 cross(const Vec3& v) const {
-        return {
-            y * v.z - z * v.y,
-            z * v.x - x * v.z,
-            x * v.y - y * v.x
-        };
-    }
+// 줄 시작이 "v " / "f " 인지 (vn, vt 등은 제외)
+bool isRecord(const char* line, const char* lineEnd, char type) {
+    return lineEnd - line > 1 && line[0] == type && (line[1] == ' ' || line[1] == '\t');
+}
 
-    float dot(const Vec3& v) const {
-        return x * v.x + y * v.y + z * v.z;
-    }
+// 면 인덱스 하나 ("7", "7/1", "7//3", "-1") → 0 기반. 읽을 수 없으면 0번 정점
+float parseIndex(const char*& p, const char* lineEnd, long long vertexCount) {
+    char* end;
+    long long index = std::strtoll(p, &end, 10);
+    if (end == p || end > lineEnd) return 0.0f;
+    p = end;
+    while (p < lineEnd && *p != ' ' && *p != '\t') ++p; // /uv/normal 건너뛰기
+    index = index < 0 ? vertexCount + index : index - 1;
+    return float(std::max(0LL, index));
+}
 
-    Vec3 normalize() const {
-        float length = sqrt(x * x + y * y + z * z);
-        return {x / length, y / length, z / length};
-    }
+float parseFloat(const char*& p, const char* lineEnd) {
+    char* end;
+    float value = std::strtof(p, &end);
+    if (end == p || end > lineEnd) return 0.0f;
+    p = end;
+    return value;
+}
 
-};
+} // namespace
 
 bool ObjLoader::load(const std::string& filename) {
-    std::ifstream fin(filename); // include <fstream>
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+
+    std::ifstream fin(filename, std::ios::binary); // include <fstream>
     if (!fin.is_open()) {
         std::cerr << "Failed to open file: " << filename << std::endl; // include <iostream>
         return false;
     }
 
-    std::string line;
-    while (std::getline(fin, line)) {
-
-        //std::istringstream : 공백(띄어쓰기, 탭, 개행)을 자동으로 구분자(separator)로 사용해서 데이터를 읽음
-        std::istringstream ss(line); // include <sstream>
-        std::string type;
-        ss >> type;
-
-        if (type == "v") {
-            Vertex v;
-            ss >> v.x >> v.y >> v.z;
-            vertices.push_back(v);
-        } else if (type == "f") {
-            Face f;
-            ss >> f.v1 >> f.v2 >> f.v3;
-
-            // index 맞추기
-            f.v1--;
-            f.v2--;
-            f.v3--;
-
-            faces.push_back(f);
-        }
-    }
-
+    // 파일 전체를 한 번에 읽고 줄 경계에 맞춘 구간으로 나눠 병렬 파싱
+    std::string text;
+    fin.seekg(0, std::ios::end);
+    text.resize(size_t(fin.tellg()));
+    fin.seekg(0);
+    fin.read(&text[0], std::streamsize(text.size()));
     fin.close();
 
-    // 카메라 기준 자동 보정 추가
-    Vec3 cameraPos = {0.0f, 0.0f, 5.0f}; // 카메라를 (0,0,5) 위치로 가정
-
-    for (auto& face : faces) {
-        Vec3 v1 = vertices[face.v1];
-        Vec3 v2 = vertices[face.v2];
-        Vec3 v3 = vertices[face.v3];
-
-        // 1. 삼각형의 법선 벡터 계산
-        Vec3 edge1 = v2 - v1;
-        Vec3 edge2 = v3 - v1;
-        Vec3 normal = edge1.cross(edge2).normalize();
-
-        // 2. 삼각형 중심 좌표 계산
-        Vec3 center = {(v1.x + v2.x + v3.x) / 3.0f, (v1.y + v2.y + v3.y) / 3.0f, (v1.z + v2.z + v3.z) / 3.0f};
-
-        // 3. 삼각형 중심에서 카메라를 향하는 벡터 계산
-        Vec3 viewVector = (cameraPos - center).normalize();
-
-        // 4. 뷰 벡터와 법선 벡터의 내적(dot product) 계산
-        float dotProduct = viewVector.dot(normal);
-
-        // 5. 삼각형이 카메라를 향하지 않으면 뒤집기 (시계방향 ↔ 반시계방향)
-        if (dotProduct < 0) {
-            std::swap(face.v1, face.v3);
-            //std::cout << "Flipped Face: " << face.v1 << ", " << face.v2 << ", " << face.v3 << std::endl;
-        } else {
-            //std::cout << "Face Normal: " << face.v1 << ", " << face.v2 << ", " << face.v3 << std::endl;
-        }
+    ThreadPool& pool = ThreadPool::instance();
+    const size_t chunkBytes = std::max<size_t>(size_t(1) << 16, text.size() / (size_t(pool.workerCount()) * 8) + 1);
+    std::vector<size_t> chunkStart{0};
+    while (chunkStart.back() < text.size()) {
+        size_t next = std::min(text.size(), chunkStart.back() + chunkBytes);
+        while (next < text.size() && text[next - 1] != '\n') ++next;
+        chunkStart.push_back(next);
     }
-
-    std::cout << "Loaded Vertices:" << std::endl;
-    for (size_t i = 0; i < vertices.size(); i++) {
-        //std::cout << i+1 << ": (" << vertices[i].x << ", " << vertices[i].y << ", " << vertices[i].z << ")" << std::endl;
+    const int chunks = int(chunkStart.size()) - 1;
+    const char* data = text.data();
+
+    // 1차 패스: 구간별 정점/면 줄 수 → 누적합이 각 구간의 쓰기 위치
+    std::vector<size_t> chunkVertices(size_t(chunks) + 1, 0);
+    std::vector<size_t> chunkFaces(size_t(chunks) + 1, 0);
+    pool.parallelFor(chunks, [&](int c, int) {
+        size_t vertexCount = 0, faceCount = 0;
+        const char* line = data + chunkStart[c];
+        const char* chunkEnd = data + chunkStart[c + 1];
+        while (line < chunkEnd) {
+            const char* lineEnd = std::find(line, chunkEnd, '\n');
+            if (isRecord(line, lineEnd, 'v')) vertexCount++;
+            else if (isRecord(line, lineEnd, 'f')) faceCount++;
+            line = lineEnd + 1;
+        }
+        chunkVertices[c + 1] = vertexCount;
+        chunkFaces[c + 1] = faceCount;
+    });
+    for (int c = 0; c < chunks; ++c) {
+        chunkVertices[c + 1] += chunkVertices[c];
+        chunkFaces[c + 1] += chunkFaces[c];
     }
 
-    std::cout << "Loaded Faces:" << std::endl;
-    for (const auto& face : faces) {
-        //std::cout << "Face: " << face.v1 << ", " << face.v2 << ", " << face.v3 << std::endl;
+    // 2차 패스: 제자리에 파싱 (음수 인덱스는 그 줄까지 읽은 정점 수 기준)
+    vertices.resize(chunkVertices[chunks]);
+    faces.resize(chunkFaces[chunks]);
+    pool.parallelFor(chunks, [&](int c, int) {
+        size_t vertex = chunkVertices[c];
+        size_t face = chunkFaces[c];
+        const char* line = data + chunkStart[c];
+        const char* chunkEnd = data + chunkStart[c + 1];
+        while (line < chunkEnd) {
+            const char* lineEnd = std::find(line, chunkEnd, '\n');
+            const char* p = line + 2;
+            if (isRecord(line, lineEnd, 'v')) {
+                Vertex& v = vertices[vertex++];
+                v.x = parseFloat(p, lineEnd);
+                v.y = parseFloat(p, lineEnd);
+                v.z = parseFloat(p, lineEnd);
+            } else if (isRecord(line, lineEnd, 'f')) {
+                Face& f = faces[face++];
+                f.v1 = parseIndex(p, lineEnd, (long long)vertex);
+                f.v2 = parseIndex(p, lineEnd, (long long)vertex);
+                f.v3 = parseIndex(p, lineEnd, (long long)vertex);
+            }
+            line = lineEnd + 1;
+        }
+    });
+
+    // 범위를 벗어난 인덱스는 0번 정점으로 (인접 구조/렌더링에서 퇴화 삼각형으로 처리)
+    const float vertexLimit = float(vertices.size());
+    for (Face& f : faces) {
+        if (!(f.v1 < vertexLimit)) f.v1 = 0.0f;
+        if (!(f.v2 < vertexLimit)) f.v2 = 0.0f;
+        if (!(f.v3 < vertexLimit)) f.v3 = 0.0f;
     }
+    auto parsed = Clock::now();
+
+    // 인접 구조 + 위상 기반 방향 정리 (연결 성분마다 감기 방향 통일, 바깥쪽으로)
+    auto built = std::make_shared<MeshTopology>();
+    built->build(vertices, faces);
+    int flipped = built->orient(vertices, faces);
+    topology = built;
+
+    auto ms = [](Clock::time_point a, Clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+    std::cout << "Loaded " << vertices.size() << " vertices, " << faces.size() << " faces (parse "
+              << ms(start, parsed) << " ms, topology " << ms(parsed, Clock::now()) << " ms, "
+              << pool.workerCount() << " threads)" << std::endl;
+    std::cout << "Topology: " << built->componentCount() << " component(s), " << flipped << " face(s) flipped, "
+              << built->boundaryEdgeCount() << " boundary edge(s), " << built->nonManifoldEdgeCount()
+              << " non-manifold edge(s), " << built->nonOrientableComponentCount() << " non-orientable component(s)"
+              << std::endl;
 
     return true;
 }
@@ -1,6 +1,7 @@
 #ifndef OBJLOADER_H
 #define OBJLOADER_H
 
+#include <memory>
 #include <vector>
 #include <iostream>
 #include <fstream>
@@ -16,13 +17,17 @@ struct Face{ // a triangle face
     float v1, v2, v3;
 };
 
+class MeshTopology;
+
 class ObjLoader{
 public:
     //변수 정의
     std::vector<Vertex> vertices;
     std::vector<Face> faces;
+    std::shared_ptr<const MeshTopology> topology; // load()가 만든 인접 구조 (직접 채운 메쉬는 nullptr)
 
     //메소드 정의
+    // 기존 내용을 바꿈. 파싱과 인접 구조 구성은 스레드 풀에서 병렬 (메인 스레드에서 호출)
     bool load(const std::string& filename);
 };
 
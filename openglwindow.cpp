@@ -1,44 +1,229 @@
 #include "openglwindow.h"
-#include <OpenGL/glu.h>
+#include "meshtopology.h"
+#include "threadpool.h"
 #include <iostream>
+#include <algorithm>
+#include <chrono>
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 
+// === GLSL 소스 ===
+// 조명/재질/카메라 파라미터는 하나의 uniform block으로 공유
+static const char* kSceneBlockGlsl = R"(
+layout(std140) uniform SceneUniforms {
+    mat4 viewProjection;
+    vec4 eyePosition;
+    vec4 lightPosition[2];
+    vec4 lightDiffuse[2];
+    vec4 lightSpecular[2];
+    vec4 ambientLight;
+    vec4 materialSpecular; // w: shininess
+    ivec4 lightEnabled;
+};
+)";
+
+// 고정 파이프라인(GL_COLOR_MATERIAL + LIGHT_MODEL_AMBIENT)과 같은 식
+static const char* kShadeGlsl = R"(
+vec3 shade(vec3 position, vec3 normal, vec3 baseColor) {
+    vec3 n = normalize(normal);
+    vec3 v = normalize(eyePosition.xyz - position);
+    vec3 color = ambientLight.rgb * baseColor;
+    for (int i = 0; i < 2; ++i) {
+        if (lightEnabled[i] == 0) continue;
+        vec3 l = normalize(lightPosition[i].xyz - position);
+        float ndotl = max(dot(n, l), 0.0);
+        color += lightDiffuse[i].rgb * ndotl * baseColor;
+        if (ndotl > 0.0) {
+            vec3 h = normalize(l + v);
+            color += lightSpecular[i].rgb * materialSpecular.rgb * pow(max(dot(n, h), 0.0), materialSpecular.w);
+        }
+    }
+    return clamp(color, 0.0, 1.0);
+}
+)";
+
+static const char* kLitVertexGlsl = R"(
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aFaceNormal;
+layout(location = 2) in vec3 aVertexNormal;
+layout(location = 3) in vec2 aTexCoord;
+
+uniform mat4 uModel;
+uniform mat3 uNormalMatrix;
+
+out vec2 vTexCoord;
+#if defined(SHADING_PHONG)
+out vec3 vPosition;
+out vec3 vNormal;
+#elif defined(SHADING_FLAT)
+flat out vec3 vColor;
+#else
+out vec3 vColor;
+#endif
+
+void main() {
+    vec4 worldPos = uModel * vec4(aPosition, 1.0);
+    vTexCoord = aTexCoord;
+#if defined(SHADING_PHONG)
+    vPosition = worldPos.xyz;
+    vNormal = uNormalMatrix * aVertexNormal;
+#elif defined(SHADING_FLAT)
+    vColor = shade(worldPos.xyz, uNormalMatrix * aFaceNormal, vec3(1.0));
+#else
+    vColor = shade(worldPos.xyz, uNormalMatrix * aVertexNormal, vec3(1.0));
+#endif
+    gl_Position = viewProjection * worldPos;
+}
+)";
+
+static const char* kLitFragmentGlsl = R"(
+uniform sampler2D uTexture;
+uniform bool uUseTexture;
+
+in vec2 vTexCoord;
+#if defined(SHADING_PHONG)
+in vec3 vPosition;
+in vec3 vNormal;
+#elif defined(SHADING_FLAT)
+flat in vec3 vColor;
+#else
+in vec3 vColor;
+#endif
+
+out vec4 fragColor;
+
+void main() {
+#if defined(SHADING_PHONG)
+    vec3 color = shade(vPosition, vNormal, vec3(1.0));
+#else
+    vec3 color = vColor;
+#endif
+    vec4 texel = uUseTexture ? texture(uTexture, vTexCoord) : vec4(1.0);
+    fragColor = vec4(color * texel.rgb, 1.0);
+}
+)";
+
+static const char* kUnlitVertexGlsl = R"(
+layout(location = 0) in vec3 aPosition;
+layout(location = 4) in vec3 aColor;
+out vec3 vColor;
+
+void main() {
+    vColor = aColor;
+    gl_Position = viewProjection * vec4(aPosition, 1.0);
+}
+)";
+
+static const char* kUnlitFragmentGlsl = R"(
+in vec3 vColor;
+out vec4 fragColor;
+
+void main() {
+    fragColor = vec4(vColor, 1.0);
+}
+)";
+
+// 하이브리드 G-buffer: 트레이서가 1차 레이로 얻을 히트 정보 (월드 위치 + objectId, 면 법선)
+// 바닥은 방 메쉬의 첫 사각형을 그대로 씀 (방 메쉬도 location 1에 면 법선이 있음)
+static const char* kSurfaceVertexGlsl = R"(
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aFaceNormal;
+
+uniform mat4 uSurfaceViewProjection;
+uniform mat4 uModel;
+uniform mat3 uNormalMatrix;
+
+out vec3 vPosition;
+flat out vec3 vNormal;
+
+void main() {
+    vec4 worldPos = uModel * vec4(aPosition, 1.0);
+    vPosition = worldPos.xyz;
+    vNormal = uNormalMatrix * aFaceNormal;
+    gl_Position = uSurfaceViewProjection * worldPos;
+}
+)";
+
+static const char* kSurfaceFragmentGlsl = R"(
+uniform float uObjectId;
+
+in vec3 vPosition;
+flat in vec3 vNormal;
+
+layout(location = 0) out vec4 outPosition;
+layout(location = 1) out vec4 outNormal;
+
+void main() {
+    outPosition = vec4(vPosition, uObjectId);
+    outNormal = vec4(vNormal, 0.0);
+}
+)";
+
 OpenGLWindow::OpenGLWindow(QWidget *parent)
     : QOpenGLWidget(parent), cowTexture(nullptr)
 {
     setFocusPolicy(Qt::StrongFocus); // 입력을 받을 수 있도록 설정
     installEventFilter(this); // QT 이벤트 필터 감지
     setupUI(); // UI 초기화 호출
+    syncTracerLights();
 }
 
-OpenGLWindow::~OpenGLWindow() {}
+OpenGLWindow::~OpenGLWindow() {
+    makeCurrent();
+    delete flatProgram;
+    delete gouraudProgram;
+    delete phongProgram;
+    delete unlitProgram;
+    delete surfaceProgram;
+    delete cowTexture;
+    cowVao.destroy();
+    cowVbo.destroy();
+    releaseGpuPages();
+    roomVao.destroy();
+    roomVbo.destroy();
+    if (sceneUbo) glDeleteBuffers(1, &sceneUbo);
+    if (surfaceFbo) {
+        glDeleteFramebuffers(1, &surfaceFbo);
+        glDeleteTextures(2, surfaceTextures);
+        glDeleteRenderbuffers(1, &surfaceDepth);
+    }
+    doneCurrent();
+}
 
 void OpenGLWindow::initializeGL() {
     initializeOpenGLFunctions();
     glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LIGHTING);
-    glEnable(GL_COLOR_MATERIAL);
-    glEnable(GL_TEXTURE_2D); // 텍스처 사용 활성화
-    glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
-    glShadeModel(shadingModel);
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 
-    // LIGHT0 설정
-    glEnable(GL_LIGHT0);
-    glLightfv(GL_LIGHT0, GL_POSITION, light0Pos);
-    glLightfv(GL_LIGHT0, GL_DIFFUSE, specularColor);
-    glLightfv(GL_LIGHT0, GL_SPECULAR, specularColor);
-
-    // LIGHT1 설정
-    glEnable(GL_LIGHT1);
-    glLightfv(GL_LIGHT1, GL_POSITION, light1Pos);
-    glLightfv(GL_LIGHT1, GL_DIFFUSE, light1Diffuse);
-    glLightfv(GL_LIGHT1, GL_SPECULAR, light1Diffuse); // specular도 동일하게
-
+    // 셰이더 프로그램 (플랫 / 고러드 / 퐁 / 조명 없는 배경)
+    flatProgram = createProgram("SHADING_FLAT", kLitVertexGlsl, kLitFragmentGlsl);
+    gouraudProgram = createProgram("SHADING_GOURAUD", kLitVertexGlsl, kLitFragmentGlsl);
+    phongProgram = createProgram("SHADING_PHONG", kLitVertexGlsl, kLitFragmentGlsl);
+    unlitProgram = createProgram("SHADING_UNLIT", kUnlitVertexGlsl, kUnlitFragmentGlsl);
+    surfaceProgram = createProgram("SURFACES", kSurfaceVertexGlsl, kSurfaceFragmentGlsl);
+    rasterReady = flatProgram && gouraudProgram && phongProgram && unlitProgram;
+    if (!rasterReady) {
+        std::cerr << "Rasterization disabled: showing the ray traced image instead." << std::endl;
+    }
+    if (!surfaceProgram) {
+        std::cerr << "Hybrid rendering disabled: tracing primary rays instead." << std::endl;
+    }
 
-    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, ambientLight);
+    // 조명 uniform buffer (binding point 0)
+    glGenBuffers(1, &sceneUbo);
+    glBindBuffer(GL_UNIFORM_BUFFER, sceneUbo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(SceneUniforms), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    sceneUniformsDirty = true;
+    glStateLost = true;
+
+    cowVao.create();
+    cowVbo.create();
+    roomVao.create();
+    roomVbo.create();
+    createRoomMesh();
+    cowMeshDirty = !objLoader.faces.empty(); // initializeGL 전에 모델이 로드된 경우
 
     // 텍스처 로드
     QImage img("/Users/hwang-yoonseon/Desktop/konkuk/wsu/cg/assignment_3/cow-tex-fin.jpg");
@@ -47,90 +232,312 @@ void OpenGLWindow::initializeGL() {
         cowTexture->setMinificationFilter(QOpenGLTexture::Linear);
         cowTexture->setMagnificationFilter(QOpenGLTexture::Linear);
         cowTexture->setWrapMode(QOpenGLTexture::Repeat);
+        rayTracer.setTexture(img); // 레이 트레이싱도 같은 텍스처 (텍스처 커널 선택)
         std::cout << "Texture loaded successfully." << std::endl;
     } else {
         std::cerr << "Failed to load cow_texture.jpg" << std::endl;
     }
+
+    // 샘플러/텍스처 사용 여부는 프로그램 상태로 한 번만 설정
+    for (QOpenGLShaderProgram* program : {flatProgram, gouraudProgram, phongProgram}) {
+        if (!program) continue;
+        program->bind();
+        program->setUniformValue("uTexture", 0);
+        program->setUniformValue("uUseTexture", cowTexture != nullptr);
+    }
+    glUseProgram(0);
+}
+
+QOpenGLShaderProgram* OpenGLWindow::createProgram(const char* define, const char* vertexSource, const char* fragmentSource) {
+    QByteArray header = QByteArray("#version 330 core\n#define ") + define + "\n" + kSceneBlockGlsl;
+
+    QOpenGLShaderProgram* program = new QOpenGLShaderProgram();
+    bool ok = program->addShaderFromSourceCode(QOpenGLShader::Vertex, header + kShadeGlsl + vertexSource)
+           && program->addShaderFromSourceCode(QOpenGLShader::Fragment, header + kShadeGlsl + fragmentSource)
+           && program->link();
+    if (!ok) {
+        std::cerr << "Failed to build shader (" << define << "): " << program->log().toStdString() << std::endl;
+        delete program;
+        return nullptr;
+    }
+
+    GLuint blockIndex = glGetUniformBlockIndex(program->programId(), "SceneUniforms");
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program->programId(), blockIndex, 0);
+    }
+    return program;
 }
 
 void OpenGLWindow::resizeGL(int w, int h) {
     glViewport(0, 0, w, h);
+    sceneUniformsDirty = true; // 투영 행렬 변경
 }
 
 void OpenGLWindow::paintGL() {
-
-    // (1) Ray Tracing 텍스처 생성
-    if (useRayTracing) {
-        renderRayTracing();
+    frameStateChanges = 0;
+    frameAllocationStart = FrameArena::heapAllocationCount();
+
+    // (1) Ray Tracing 텍스처 생성 (하이브리드는 1차 가시성만 GL로)
+    //     셰이더 빌드에 실패했으면 래스터 대신 트레이서로 그림
+    if (useRayTracing || !rasterReady) {
+        if (useHybrid && useRayTracing && surfaceProgram) {
+            renderHybrid();
+        } else {
+            renderRayTracing();
+        }
+        glStateLost = true; // QPainter가 GL 상태를 바꿈
+        reportStateChanges();
+        FrameArena::endFrame();
         return;
     }
 
-    // (2) OpenGL 씬 클리어 및 설정
+    // (2) 컨텍스트 상태 복구 및 더티 데이터 업로드
+    if (glStateLost) restoreGlState();
+    if (cowMeshDirty) uploadCowMesh();
+    if (sceneUniformsDirty) uploadSceneUniforms();
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    ++frameStateChanges;
 
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(45.0, float(width()) / height(), 0.1, 100.0);
+    // (3) 씬 렌더링
+    drawFloorAndWalls();
 
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    gluLookAt(0.0, 3.0, 10.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);
+    if (cowVertexCount == 0 && !usePagedMesh) {
+        reportStateChanges();
+        reportFrameAllocations();
+        FrameArena::endFrame();
+        return;
+    }
 
-    if (light0On) {
-        glEnable(GL_LIGHTING);
-        glEnable(GL_LIGHT0);
-        glLightfv(GL_LIGHT0, GL_POSITION, light0Pos);
-        glLightfv(GL_LIGHT0, GL_DIFFUSE, specularColor);
-        glLightfv(GL_LIGHT0, GL_SPECULAR, specularColor);
-    } else {
-        glEnable(GL_LIGHTING);
-        GLfloat noDiffuse[4] = {0.0f, 0.0f, 0.0f, 1.0f};
-        glLightfv(GL_LIGHT0, GL_DIFFUSE, noDiffuse);
-        glLightfv(GL_LIGHT0, GL_SPECULAR, noDiffuse);
+    useProgram(currentLitProgram());
+    if (cowTexture && !cowTextureBound) {
+        cowTexture->bind(0);
+        cowTextureBound = true;
+        ++frameStateChanges;
     }
 
-    // Light 1
-    if (light1On) {
-        glEnable(GL_LIGHT1);
-        glLightfv(GL_LIGHT1, GL_POSITION, light1Pos);
-        glLightfv(GL_LIGHT1, GL_DIFFUSE, light1Diffuse);
-        glLightfv(GL_LIGHT1, GL_SPECULAR, light1Diffuse);
+    if (usePagedMesh) {
+        drawPagedCows(viewProjectionMatrix());
     } else {
-        glDisable(GL_LIGHT1);
+        // Draw first cow (left), second cow (right)
+        bindVao(&cowVao);
+        drawCow(cowModelMatrix(0));
+        drawCow(cowModelMatrix(1));
     }
 
-    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, ambientLight);
-    glShadeModel(shadingModel);
+    reportStateChanges();
+    reportPagedMesh();
+    reportFrameAllocations();
+    FrameArena::endFrame();
+}
 
-    // (3) 씬 렌더링
-    drawFloorAndWalls();
+void OpenGLWindow::restoreGlState() {
+    glEnable(GL_DEPTH_TEST);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, sceneUbo);
+    frameStateChanges += 2;
+    boundProgram = nullptr;
+    boundVao = nullptr;
+    cowTextureBound = false;
+    glStateLost = false;
+}
+
+QOpenGLShaderProgram* OpenGLWindow::currentLitProgram() const {
+    switch (shadingMode) {
+    case ShadingMode::Flat: return flatProgram;
+    case ShadingMode::Phong: return phongProgram;
+    default: return gouraudProgram;
+    }
+}
+
+// 이미 바인딩된 프로그램/VAO는 다시 바인딩하지 않음
+void OpenGLWindow::useProgram(QOpenGLShaderProgram* program) {
+    if (boundProgram == program) return;
+    program->bind();
+    boundProgram = program;
+    ++frameStateChanges;
+}
+
+void OpenGLWindow::bindVao(QOpenGLVertexArrayObject* vao) {
+    if (boundVao == vao) return;
+    vao->bind();
+    boundVao = vao;
+    ++frameStateChanges;
+}
+
+QMatrix4x4 OpenGLWindow::viewProjectionMatrix() const {
+    QMatrix4x4 viewProjection;
+    viewProjection.perspective(45.0f, float(width()) / std::max(1, height()), 0.1f, 100.0f);
+    viewProjection.lookAt(QVector3D(0.0f, 3.0f, 10.0f), QVector3D(0.0f, 0.0f, 0.0f), QVector3D(0.0f, 1.0f, 0.0f));
+    return viewProjection;
+}
+
+// 더티 플래그가 켜졌을 때만 uniform block 전체를 한 번에 업로드
+void OpenGLWindow::uploadSceneUniforms() {
+    SceneUniforms u = {};
+
+    QMatrix4x4 viewProjection = viewProjectionMatrix();
+    std::copy(viewProjection.constData(), viewProjection.constData() + 16, u.viewProjection);
+
+    u.eyePosition[0] = 0.0f; u.eyePosition[1] = 3.0f; u.eyePosition[2] = 10.0f; u.eyePosition[3] = 1.0f;
+
+    for (int i = 0; i < 4; ++i) {
+        u.lightPosition[0][i] = light0Pos[i];
+        u.lightDiffuse[0][i] = specularColor[i];
+        u.lightSpecular[0][i] = specularColor[i];
+
+        u.lightPosition[1][i] = light1Pos[i];
+        u.lightDiffuse[1][i] = light1Diffuse[i];
+        u.lightSpecular[1][i] = light1Diffuse[i];
+
+        u.ambientLight[i] = ambientLight[i];
+        u.materialSpecular[i] = materialSpecular[i];
+    }
+    u.lightEnabled[0] = light0On ? 1 : 0;
+    u.lightEnabled[1] = light1On ? 1 : 0;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, sceneUbo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SceneUniforms), &u);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    ++frameStateChanges;
+
+    sceneUniformsDirty = false;
+}
+
+// 소 메쉬: 위치 / 면 법선 / 정점 법선 / 텍스처 좌표를 한 번만 VBO로 업로드
+void OpenGLWindow::uploadCowMesh() {
+    if (!objLoader.topology) return;
+    const auto& vertices = objLoader.vertices;
+    const auto& faces = objLoader.faces;
+
+    // 1. 면 법선 → 정점 법선 (인접 구조에서 정점에 붙은 면의 법선 합, 면 순서대로라 직렬 누적과 같은 값)
+    ThreadPool& pool = ThreadPool::instance();
+    const int faceCount = int(faces.size());
+    const int vertexCount = int(vertices.size());
+    const int chunk = 4096;
+    std::vector<QVector3D> faceNormals(faces.size());
+    pool.parallelFor((faceCount + chunk - 1) / chunk, [&](int c, int) {
+        for (int f = c * chunk; f < std::min(faceCount, (c + 1) * chunk); ++f) {
+            const auto& v1 = vertices[faces[f].v1];
+            const auto& v2 = vertices[faces[f].v2];
+            const auto& v3 = vertices[faces[f].v3];
+            faceNormals[f] = QVector3D::normal(QVector3D(v2.x - v1.x, v2.y - v1.y, v2.z - v1.z),
+                                               QVector3D(v3.x - v1.x, v3.y - v1.y, v3.z - v1.z));
+        }
+    });
+    std::vector<QVector3D> vertexNormals(vertices.size());
+    const MeshTopology& topology = *objLoader.topology;
+    pool.parallelFor((vertexCount + chunk - 1) / chunk, [&](int c, int) {
+        for (int v = c * chunk; v < std::min(vertexCount, (c + 1) * chunk); ++v) {
+            QVector3D n(0, 0, 0);
+            for (int h : topology.outgoing(v)) n += faceNormals[MeshTopology::face(h)];
+            vertexNormals[v] = n.normalized();
+        }
+    });
+
+    // 2. 인터리브 버퍼 (pos3, faceNormal3, vertexNormal3, uv2)
+    std::vector<GLfloat> buffer(faces.size() * 3 * 11);
+    pool.parallelFor((faceCount + chunk - 1) / chunk, [&](int c, int) {
+        for (int f = c * chunk; f < std::min(faceCount, (c + 1) * chunk); ++f) {
+            const QVector3D& fn = faceNormals[f];
+            GLfloat* out = buffer.data() + size_t(f) * 3 * 11;
+            for (int idx : {int(faces[f].v1), int(faces[f].v2), int(faces[f].v3)}) {
+                const auto& v = vertices[idx];
+                const QVector3D& vn = vertexNormals[idx];
+                const GLfloat attributes[11] = {
+                    v.x, v.y, v.z,
+                    fn.x(), fn.y(), fn.z(),
+                    vn.x(), vn.y(), vn.z(),
+                    (v.x + 1.0f) * 0.5f, (v.z + 1.0f) * 0.5f // 임의 텍스처 좌표 (x, z 기반)
+                };
+                out = std::copy(attributes, attributes + 11, out);
+            }
+        }
+    });
+    cowVertexCount = int(faces.size() * 3);
+
+    const int stride = 11 * sizeof(GLfloat);
+    cowVao.bind();
+    cowVbo.bind();
+    cowVbo.allocate(buffer.data(), int(buffer.size() * sizeof(GLfloat)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(3 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(6 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(9 * sizeof(GLfloat)));
+    cowVao.release();
+    cowVbo.release();
+    boundVao = nullptr;
+    ++frameStateChanges;
+
+    cowMeshDirty = false;
+}
+
+// 바닥 + 벽 3개 (위치3, 색상3)
+void OpenGLWindow::createRoomMesh() {
+    struct Quad { QVector3D a, b, c, d, color; };
+    const Quad quads[] = {
+        // 바닥
+        { {-10.0f, -1.0f, -10.0f}, {-10.0f, -1.0f, 10.0f}, {10.0f, -1.0f, 10.0f}, {10.0f, -1.0f, -10.0f}, {0.5f, 0.5f, 0.5f} },
+        // 벽 1
+        { {-10.0f, -1.0f, -10.0f}, {-10.0f, 5.0f, -10.0f}, {10.0f, 5.0f, -10.0f}, {10.0f, -1.0f, -10.0f}, {0.4f, 0.4f, 0.6f} },
+        // 벽 2
+        { {-10.0f, -1.0f, 10.0f}, {-10.0f, 5.0f, 10.0f}, {10.0f, 5.0f, 10.0f}, {10.0f, -1.0f, 10.0f}, {0.6f, 0.4f, 0.4f} },
+        // 벽 3 (왼쪽)
+        { {-10.0f, -1.0f, -10.0f}, {-10.0f, 5.0f, -10.0f}, {-10.0f, 5.0f, 10.0f}, {-10.0f, -1.0f, 10.0f}, {0.4f, 0.6f, 0.4f} },
+    };
+
+    // 위치(0), 면 법선(1), 색(4): 법선 자리는 소 메쉬와 같아서 G-buffer 패스가 그대로 읽음
+    std::vector<GLfloat> buffer;
+    for (const Quad& q : quads) {
+        const QVector3D normal = QVector3D::normal(q.b - q.a, q.c - q.a);
+        for (const QVector3D* p : {&q.a, &q.b, &q.c, &q.a, &q.c, &q.d}) {
+            buffer.insert(buffer.end(), { p->x(), p->y(), p->z(), normal.x(), normal.y(), normal.z(),
+                                          q.color.x(), q.color.y(), q.color.z() });
+        }
+    }
+    roomVertexCount = int(buffer.size() / 9);
+
+    const int stride = 9 * sizeof(GLfloat);
+    roomVao.bind();
+    roomVbo.bind();
+    roomVbo.allocate(buffer.data(), int(buffer.size() * sizeof(GLfloat)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(3 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(6 * sizeof(GLfloat)));
+    roomVao.release();
+    roomVbo.release();
+}
 
-    // Draw first cow (left)
-    glPushMatrix();
-    glTranslatef(-2.5f, autoOffsetY, 0.0f);
-    glRotatef(cow1RotationX, 1.0f, 0.0f, 0.0f);
-    glRotatef(cow1RotationY, 0.0f, 1.0f, 0.0f);
-    glRotatef(cow1RotationZ, 0.0f, 0.0f, 1.0f);
-    glScalef(0.3f, 0.3f, 0.3f);
-    glColor3f(1.0, 1.0, 1.0);
-    drawCow();
-    glPopMatrix();
-
-    // Draw second cow (right)
-    glPushMatrix();
-    glTranslatef(2.5f, autoOffsetY, 0.0f);
-    glRotatef(cow2RotationX, 1.0f, 0.0f, 0.0f);
-    glRotatef(cow2RotationY, 0.0f, 1.0f, 0.0f);
-    glRotatef(cow2RotationZ, 0.0f, 0.0f, 1.0f);
-    glScalef(0.3f, 0.3f, 0.3f);
-    glColor3f(1.0, 1.0, 1.0);
-    drawCow();
-    glPopMatrix();
+void OpenGLWindow::reportStateChanges() {
+    if (!verbose) return;
+    if (frameStateChanges != lastFrameStateChanges) {
+        std::cout << "GL state changes per frame: " << frameStateChanges << std::endl;
+        lastFrameStateChanges = frameStateChanges;
+    }
+}
+
+void OpenGLWindow::reportFrameAllocations() {
+    if (!FrameArena::countsHeapAllocations()) return;
+    long long allocations = (long long)(FrameArena::heapAllocationCount() - frameAllocationStart);
+    if (allocations != lastFrameAllocations) {
+        std::cout << "Heap allocations per frame: " << allocations << std::endl;
+        lastFrameAllocations = allocations;
+    }
 }
 
 void OpenGLWindow::loadModel(const std::string& filename) {
     if (objLoader.load(filename)) {
         std::cout << "Model loaded: " << filename << std::endl;
+        usePagedMesh = false;
+        rayTracer.setPagedMesh(nullptr);
+        temporalCache.invalidate();
+        rayTracer.invalidateLightmap();
 
         // === autoOffsetY 계산 ===
         float minY = std::numeric_limits<float>::max();
@@ -138,6 +545,8 @@ void OpenGLWindow::loadModel(const std::string& filename) {
             if (v.y < minY) minY = v.y;
         }
         autoOffsetY = -minY;  // 바닥에 닿도록 offset 설정
+        cowMeshDirty = true;  // 다음 paintGL에서 VBO 재생성
+        syncTracerInstances();
 
         update();
     } else {
@@ -145,6 +554,32 @@ void OpenGLWindow::loadModel(const std::string& filename) {
     }
 }
 
+bool OpenGLWindow::loadPagedModel(const std::string& path, size_t memoryBudgetBytes) {
+    if (!pagedMesh.open(path)) {
+        std::cerr << "Failed to open paged model." << std::endl;
+        return false;
+    }
+    pagedMesh.setMemoryBudget(memoryBudgetBytes);
+    gpuPageBudget = memoryBudgetBytes;
+
+    if (context()) {
+        makeCurrent();
+        releaseGpuPages();
+        doneCurrent();
+    }
+    gpuPages.clear();
+    gpuPages.resize(pagedMesh.pageCount());
+    usePagedMesh = true;
+
+    autoOffsetY = -pagedMesh.boundsMin().y; // 바닥에 닿도록 offset 설정
+    rayTracer.setPagedMesh(&pagedMesh);
+    temporalCache.invalidate();
+    rayTracer.invalidateLightmap();
+    syncTracerInstances();
+    update();
+    return true;
+}
+
 void OpenGLWindow::mouseMoveEvent(QMouseEvent *event) {
     float dx = event->pos().x() - lastMousePosition.x();
     float dy = event->pos().y() - lastMousePosition.y();
@@ -157,6 +592,7 @@ void OpenGLWindow::mouseMoveEvent(QMouseEvent *event) {
             cow2RotationY += dx * 0.5f;
             cow2RotationX += dy * 0.5f;
         }
+        syncTracerInstances();
         update();
     }
 
@@ -179,203 +615,134 @@ void OpenGLWindow::mouseReleaseEvent(QMouseEvent *event) {
     }
 }
 
-void OpenGLWindow::drawCow() {
-
-    if (cowTexture) cowTexture->bind(); // 텍스처 바인딩
-
-    if (shadingModel == GL_FLAT) {
-        glShadeModel(GL_FLAT);
-        glBegin(GL_TRIANGLES);
-        for (const auto& face : objLoader.faces) {
-            const auto& v1 = objLoader.vertices[face.v1];
-            const auto& v2 = objLoader.vertices[face.v2];
-            const auto& v3 = objLoader.vertices[face.v3];
-
-            float ux = v2.x - v1.x, uy = v2.y - v1.y, uz = v2.z - v1.z;
-            float vx = v3.x - v1.x, vy = v3.y - v1.y, vz = v3.z - v1.z;
-
-            float nx = uy * vz - uz * vy;
-            float ny = uz * vx - ux * vz;
-            float nz = ux * vy - uy * vx;
-
-            float length = sqrt(nx * nx + ny * ny + nz * nz);
-            if (length != 0.0f) { nx /= length; ny /= length; nz /= length; }
-
-            glNormal3f(nx, ny, nz);
-
-            // 임의 텍스처 좌표 생성 (x, z 기반)
-            glTexCoord2f((v1.x + 1.0f) * 0.5f, (v1.z + 1.0f) * 0.5f); glVertex3f(v1.x, v1.y, v1.z);
-            glTexCoord2f((v2.x + 1.0f) * 0.5f, (v2.z + 1.0f) * 0.5f); glVertex3f(v2.x, v2.y, v2.z);
-            glTexCoord2f((v3.x + 1.0f) * 0.5f, (v3.z + 1.0f) * 0.5f); glVertex3f(v3.x, v3.y, v3.z);
-        }
-        glEnd();
-    } else {
-        glShadeModel(GL_SMOOTH);
-
-        // 1. 정점별 normal을 계산하기 위한 배열 초기화
-        std::vector<QVector3D> vertexNormals(objLoader.vertices.size(), QVector3D(0, 0, 0));
-        std::vector<int> count(objLoader.vertices.size(), 0);
-
-        // 2. 각 face의 normal을 각 vertex에 더해줌
-        for (const auto& face : objLoader.faces) {
-            const auto& v1 = objLoader.vertices[face.v1];
-            const auto& v2 = objLoader.vertices[face.v2];
-            const auto& v3 = objLoader.vertices[face.v3];
-
-            QVector3D vec1(v1.x, v1.y, v1.z);
-            QVector3D vec2(v2.x, v2.y, v2.z);
-            QVector3D vec3(v3.x, v3.y, v3.z);
-
-            QVector3D normal = QVector3D::normal(vec2 - vec1, vec3 - vec1); // cross product
-            normal.normalize();
-
-            vertexNormals[face.v1] += normal;
-            vertexNormals[face.v2] += normal;
-            vertexNormals[face.v3] += normal;
-
-            count[face.v1]++;
-            count[face.v2]++;
-            count[face.v3]++;
-        }
-
-        // 3. 평균화
-        for (int i = 0; i < vertexNormals.size(); ++i) {
-            if (count[i] > 0)
-                vertexNormals[i] /= count[i];
-        }
-
-        // 4. 그리기
-        glBegin(GL_TRIANGLES);
-        for (const auto& face : objLoader.faces) {
-            for (int idx : {face.v1, face.v2, face.v3}) {
-                const auto& v = objLoader.vertices[idx];
-                const QVector3D& n = vertexNormals[idx];
-                glNormal3f(n.x(), n.y(), n.z());
-                glTexCoord2f((v.x + 1.0f) * 0.5f, (v.z + 1.0f) * 0.5f); // 임의 텍스처 좌표 (v.x, v.z 기준)
-                glVertex3f(v.x, v.y, v.z);
-            }
-        }
-        glEnd();
-    }
-
-    if (cowTexture) cowTexture->release(); // 텍스처 해제
-
+void OpenGLWindow::drawCow(const QMatrix4x4& model) {
+    // 모델 행렬만 프레임마다 갱신 (조명/재질은 uniform block)
+    boundProgram->setUniformValue("uModel", model);
+    boundProgram->setUniformValue("uNormalMatrix", model.normalMatrix());
+    frameStateChanges += 2;
+    glDrawArrays(GL_TRIANGLES, 0, cowVertexCount);
 }
 
 void OpenGLWindow::drawFloorAndWalls() {
-    glDisable(GL_LIGHTING);
-    glColor3f(0.5f, 0.5f, 0.5f);
-
-    // 바닥
-    glBegin(GL_QUADS);
-    glVertex3f(-10.0f, -1.0f, -10.0f);
-    glVertex3f(-10.0f, -1.0f, 10.0f);
-    glVertex3f(10.0f, -1.0f, 10.0f);
-    glVertex3f(10.0f, -1.0f, -10.0f);
-    glEnd();
-
-    // 벽 1
-    glColor3f(0.4f, 0.4f, 0.6f);
-    glBegin(GL_QUADS);
-    glVertex3f(-10.0f, -1.0f, -10.0f);
-    glVertex3f(-10.0f, 5.0f, -10.0f);
-    glVertex3f(10.0f, 5.0f, -10.0f);
-    glVertex3f(10.0f, -1.0f, -10.0f);
-    glEnd();
-
-    // 벽 2
-    glColor3f(0.6f, 0.4f, 0.4f);
-    glBegin(GL_QUADS);
-    glVertex3f(-10.0f, -1.0f, 10.0f);
-    glVertex3f(-10.0f, 5.0f, 10.0f);
-    glVertex3f(10.0f, 5.0f, 10.0f);
-    glVertex3f(10.0f, -1.0f, 10.0f);
-    glEnd();
-
-    // 벽 3 (왼쪽)
-    glColor3f(0.4f, 0.6f, 0.4f);
-    glBegin(GL_QUADS);
-    glVertex3f(-10.0f, -1.0f, -10.0f);
-    glVertex3f(-10.0f, 5.0f, -10.0f);
-    glVertex3f(-10.0f, 5.0f, 10.0f);
-    glVertex3f(-10.0f, -1.0f, 10.0f);
-    glEnd();
-
-    glEnable(GL_LIGHTING);
+    // 조명 없이 정점 색상만 사용
+    useProgram(unlitProgram);
+    bindVao(&roomVao);
+    glDrawArrays(GL_TRIANGLES, 0, roomVertexCount);
 }
 
 void OpenGLWindow::toggleLight0(bool enabled) {
     light0On = enabled;
-    makeCurrent();
+    sceneUniformsDirty = true;
+    syncTracerLights();
     update();
 }
 
 void OpenGLWindow::toggleLight1(bool enabled) {
     light1On = enabled;
-    makeCurrent();
+    sceneUniformsDirty = true;
+    syncTracerLights();
     update();
 }
 
+void OpenGLWindow::toggleSoftShadows(bool enabled) {
+    rayTracer.lightRadius = enabled ? 1.0f : 0.0f; // 구형 광원 → 1 spp에서는 노이즈
+    update();
+}
+
+void OpenGLWindow::toggleDenoise(bool enabled) {
+    rayTracer.denoise = enabled;
+    update();
+}
+
+void OpenGLWindow::setRayTracing(bool enabled) {
+    useRayTracing = enabled;
+    update();
+}
+
+void OpenGLWindow::toggleHybrid(bool enabled) {
+    useHybrid = enabled;
+    update();
+}
+
+void OpenGLWindow::setHybrid(bool enabled) {
+    hybridCheckbox->setChecked(enabled);
+}
+
+void OpenGLWindow::setDenoise(bool enabled) {
+    denoiseCheckbox->setChecked(enabled);
+    rayTracer.denoise = enabled; // 이미 같은 상태면 toggled가 오지 않음
+}
+
+void OpenGLWindow::setLightmapDensity(float texelsPerUnit) {
+    rayTracer.lightmap = texelsPerUnit > 0.0f;
+    if (rayTracer.lightmap) rayTracer.lightmapDensity = texelsPerUnit;
+    update();
+}
 
 void OpenGLWindow::setFlatShading() {
-    shadingModel = GL_FLAT;
-    makeCurrent();
-    glShadeModel(shadingModel);
+    shadingMode = ShadingMode::Flat;
     update();
 }
 
 void OpenGLWindow::setGouraudShading() {
-    shadingModel = GL_SMOOTH;
-    makeCurrent();
-    glShadeModel(shadingModel);
+    shadingMode = ShadingMode::Gouraud;
+    update();
+}
+
+void OpenGLWindow::setPhongShading() {
+    shadingMode = ShadingMode::Phong;
     update();
 }
 
 void OpenGLWindow::updateAmbientR(int value) {
     ambientLight[0] = value / 100.0f;
-    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, ambientLight);
+    sceneUniformsDirty = true;
     update();
 }
 
 void OpenGLWindow::updateAmbientG(int value) {
     ambientLight[1] = value / 100.0f;
-    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, ambientLight);
+    sceneUniformsDirty = true;
     update();
 }
 
 void OpenGLWindow::updateAmbientB(int value) {
     ambientLight[2] = value / 100.0f;
-    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, ambientLight);
+    sceneUniformsDirty = true;
     update();
 }
 
 void OpenGLWindow::updateAmbientA(int value) {
     ambientLight[3] = value / 100.0f;
-    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, ambientLight);
+    sceneUniformsDirty = true;
     update();
 }
 
 void OpenGLWindow::updateSpecularR(int value) {
     specularColor[0] = value / 100.0f;
-    glLightfv(GL_LIGHT0, GL_SPECULAR, specularColor);
+    sceneUniformsDirty = true;
+    syncTracerLights();
     update();
 }
 
 void OpenGLWindow::updateSpecularG(int value) {
     specularColor[1] = value / 100.0f;
-    glLightfv(GL_LIGHT0, GL_SPECULAR, specularColor);
+    sceneUniformsDirty = true;
+    syncTracerLights();
     update();
 }
 
 void OpenGLWindow::updateSpecularB(int value) {
     specularColor[2] = value / 100.0f;
-    glLightfv(GL_LIGHT0, GL_SPECULAR, specularColor);
+    sceneUniformsDirty = true;
+    syncTracerLights();
     update();
 }
 
 void OpenGLWindow::updateSpecularA(int value) {
     specularColor[3] = value / 100.0f;
-    glLightfv(GL_LIGHT0, GL_SPECULAR, specularColor);
+    sceneUniformsDirty = true;
+    syncTracerLights();
     update();
 }
 
@@ -397,18 +764,37 @@ void OpenGLWindow::setupUI() {
     light1Checkbox->setChecked(true);
     connect(light1Checkbox, &QCheckBox::toggled, this, &OpenGLWindow::toggleLight1);
 
+    // 레이 트레이싱 옵션
+    softShadowCheckbox = new QCheckBox("Soft Shadows", this);
+    softShadowCheckbox->setChecked(false);
+    connect(softShadowCheckbox, &QCheckBox::toggled, this, &OpenGLWindow::toggleSoftShadows);
+
+    denoiseCheckbox = new QCheckBox("Denoise", this);
+    denoiseCheckbox->setChecked(true);
+    connect(denoiseCheckbox, &QCheckBox::toggled, this, &OpenGLWindow::toggleDenoise);
+
+    hybridCheckbox = new QCheckBox("Hybrid (GL primary rays)", this);
+    hybridCheckbox->setChecked(false);
+    connect(hybridCheckbox, &QCheckBox::toggled, this, &OpenGLWindow::toggleHybrid);
+
     controlLayout->addWidget(light0Checkbox);
     controlLayout->addWidget(light1Checkbox);
+    controlLayout->addWidget(softShadowCheckbox);
+    controlLayout->addWidget(denoiseCheckbox);
+    controlLayout->addWidget(hybridCheckbox);
 
     // 셰이딩 버튼 가로 정렬
     flatButton = new QPushButton("Flat Shading", this);
     gouraudButton = new QPushButton("Gouraud Shading", this);
+    phongButton = new QPushButton("Phong Shading", this);
     connect(flatButton, &QPushButton::clicked, this, &OpenGLWindow::setFlatShading);
     connect(gouraudButton, &QPushButton::clicked, this, &OpenGLWindow::setGouraudShading);
+    connect(phongButton, &QPushButton::clicked, this, &OpenGLWindow::setPhongShading);
 
     QHBoxLayout* shadingButtonsLayout = new QHBoxLayout();
     shadingButtonsLayout->addWidget(flatButton);
     shadingButtonsLayout->addWidget(gouraudButton);
+    shadingButtonsLayout->addWidget(phongButton);
 
     // Ambient 슬라이더
     ambientRSlider = new QSlider(Qt::Horizontal, this);
@@ -484,157 +870,322 @@ void OpenGLWindow::setupUI() {
     setLayout(outerLayout);
 }
 
-// 레이와 삼각형 교차 체크
-bool OpenGLWindow::intersectRayTriangle(const Ray& ray, const QVector3D& v0, const QVector3D& v1, const QVector3D& v2, float& t, QVector3D& normal) {
-    const float EPSILON = 1e-6;
-    QVector3D edge1 = v1 - v0;
-    QVector3D edge2 = v2 - v0;
-    QVector3D h = QVector3D::crossProduct(ray.direction, edge2);
-    float a = QVector3D::dotProduct(edge1, h);
-    if (fabs(a) < EPSILON) return false;
-
-    float f = 1.0 / a;
-    QVector3D s = ray.origin - v0;
-    float u = f * QVector3D::dotProduct(s, h);
-    if (u < 0.0 || u > 1.0) return false;
-
-    QVector3D q = QVector3D::crossProduct(s, edge1);
-    float v = f * QVector3D::dotProduct(ray.direction, q);
-    if (v < 0.0 || u + v > 1.0) return false;
-
-    t = f * QVector3D::dotProduct(edge2, q);
-    if (t > EPSILON) {
-        normal = QVector3D::crossProduct(edge1, edge2).normalized();
-        return true;
-    }
-    return false;
-}
-
-// 장면 내 레이 교차 확인
-OpenGLWindow::HitInfo OpenGLWindow::traceRay(const Ray& ray) {
-    float closestT = 1e6;
-    HitInfo result;
-
-    // (1) 모델 교차 검사
-    for (const auto& face : objLoader.faces) {
-        const auto& v0 = objLoader.vertices[face.v1];
-        const auto& v1 = objLoader.vertices[face.v2];
-        const auto& v2 = objLoader.vertices[face.v3];
-
-        QVector3D vert0(v0.x, v0.y, v0.z);
-        QVector3D vert1(v1.x, v1.y, v1.z);
-        QVector3D vert2(v2.x, v2.y, v2.z);
-
-        float t;
-        QVector3D normal;
-        if (intersectRayTriangle(ray, vert0, vert1, vert2, t, normal)) {
-            if (t < closestT && !std::isnan(t)) {
-                closestT = t;
-                result.hit = true;
-                result.distance = t;
-                result.position = ray.origin + ray.direction * t;
-                result.normal = normal;
-                result.objectId = 1; // 소
-            }
-        }
+// 전체 이미지 렌더링
+void OpenGLWindow::renderRayTracing() {
+    if (rayTraceImage.size() != size()) {
+        rayTraceImage = QImage(size(), QImage::Format_RGB32);
     }
 
-    // (2) 바닥 y = -1 평면 검사
-    if (fabs(ray.direction.y()) > 1e-6f) {
-        float t = (-1.0f - ray.origin.y()) / ray.direction.y();
-        if (t > 0.0f && t < closestT) {
-            QVector3D hitPoint = ray.origin + t * ray.direction;
-            if (hitPoint.x() >= -10.0f && hitPoint.x() <= 10.0f &&
-                hitPoint.z() >= -10.0f && hitPoint.z() <= 10.0f) {
-                closestT = t;
-                result.hit = true;
-                result.distance = t;
-                result.position = hitPoint;
-                result.normal = QVector3D(0, 1, 0); // 바닥 normal
-                result.objectId = 0; // 바닥
-            }
-        }
+    RayTracer::RenderStats stats = temporalCache.render(rayTracer, rayTraceImage);
+    reportFrameAllocations(); // QPainter 블릿은 제외하고 측정
+    if (verbose) {
+        std::cout << "Ray tracing: trace " << stats.traceMs << " ms (" << stats.tracedFraction * 100.0
+                  << "% of pixels), denoise " << stats.denoiseMs << " ms, average path length "
+                  << stats.averagePathLength << std::endl;
     }
+    reportLightmap(stats);
+    reportPagedMesh();
 
-    return result;
+    QPainter painter(this);
+    painter.drawImage(0, 0, rayTraceImage);
 }
 
-
-// 섀도우 레이
-bool OpenGLWindow::isInShadow(const QVector3D& point, const QVector3D& lightPos) {
-    QVector3D dir = (lightPos - point).normalized();
-    Ray shadowRay{ point + dir * 0.01f, dir };
-    HitInfo hit = traceRay(shadowRay);
-    float distToLight = (lightPos - point).length();
-    return hit.hit && hit.distance < distToLight;
+// 라이트맵을 다시 구운 프레임만 출력
+void OpenGLWindow::reportLightmap(const RayTracer::RenderStats& stats) {
+    if (stats.lightmapTexels == 0) return;
+    std::cout << "Floor lightmap: baked " << stats.lightmapTexels << " texels in " << stats.lightmapMs << " ms" << std::endl;
 }
 
-QVector3D OpenGLWindow::traceRecursive(const Ray& ray, int depth) {
-    if (depth > maxDepth) return QVector3D(0.1f, 0.1f, 0.1f); // 배경색
+// 하이브리드: 1차 가시성은 GL G-buffer로, 그림자/반사만 트레이서가 추적
+void OpenGLWindow::renderHybrid() {
+    using Clock = std::chrono::steady_clock;
+    if (rayTraceImage.size() != size()) {
+        rayTraceImage = QImage(size(), QImage::Format_RGB32);
+    }
+
+    auto rasterStart = Clock::now();
+    RayTracer::PrimarySurfaces surfaces;
+    rasterizeSurfaces(surfaces);
+    double rasterMs = std::chrono::duration<double, std::milli>(Clock::now() - rasterStart).count();
 
-    HitInfo hit = traceRay(ray);
-    if (!hit.hit || std::isnan(hit.normal.x())) {
-        return QVector3D(0.2f, 0.2f, 0.2f);
+    RayTracer::RenderStats stats = rayTracer.render(surfaces, rayTraceImage);
+    reportFrameAllocations();
+    if (verbose) {
+        std::cout << "Hybrid: raster + readback " << rasterMs << " ms, trace " << stats.traceMs << " ms, denoise "
+                  << stats.denoiseMs << " ms, average path length " << stats.averagePathLength << std::endl;
     }
+    reportLightmap(stats);
+    reportPagedMesh();
 
-    QVector3D color(0.0f, 0.0f, 0.0f);
-    QVector3D lightDir = (lightPos - hit.position).normalized();
+    QPainter painter(this);
+    painter.drawImage(0, 0, rayTraceImage);
+}
 
-    // 바닥에 그림자만
-    if (hit.objectId == 0) {
-        color = QVector3D(0.3f, 0.3f, 0.3f); // 기본 바닥색
-        if (isInShadow(hit.position, lightPos)) {
-            color *= 0.2f; // 그림자 영역은 어둡게
+// 트레이서 카메라로 G-buffer를 그리고 프레임 아레나로 읽어옴
+void OpenGLWindow::rasterizeSurfaces(RayTracer::PrimarySurfaces& surfaces) {
+    const int w = rayTraceImage.width();
+    const int h = rayTraceImage.height();
+    if (glStateLost) restoreGlState();
+    if (cowMeshDirty) uploadCowMesh();
+    if (surfaceSize != QSize(w, h)) resizeSurfaceTargets(w, h);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, surfaceFbo);
+    glViewport(0, 0, w, h);
+    const GLfloat noSurface[4] = { 0.0f, 0.0f, 0.0f, -1.0f };
+    const GLfloat noNormal[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const GLfloat farDepth = 1.0f;
+    glClearBufferfv(GL_COLOR, 0, noSurface);
+    glClearBufferfv(GL_COLOR, 1, noNormal);
+    glClearBufferfv(GL_DEPTH, 0, &farDepth);
+    frameStateChanges += 5;
+
+    // 트레이서 카메라: cameraPos에서 -z 방향, 방향 (x, y, -1)의 x, y ∈ [-1, 1]이 화면 전체 (종횡비 보정 없음)
+    // 트레이서는 픽셀 모서리 좌표로 쏘므로 반 픽셀 옮겨서 GL 픽셀 중심에 맞춤
+    QMatrix4x4 viewProjection;
+    viewProjection.translate(1.0f / w, -1.0f / h, 0.0f);
+    viewProjection.frustum(-0.1f, 0.1f, -0.1f, 0.1f, 0.1f, 100.0f);
+    viewProjection.translate(-rayTracer.cameraPos);
+
+    useProgram(surfaceProgram);
+    surfaceProgram->setUniformValue("uSurfaceViewProjection", viewProjection);
+    surfaceProgram->setUniformValue("uModel", QMatrix4x4());
+    surfaceProgram->setUniformValue("uNormalMatrix", QMatrix3x3());
+    surfaceProgram->setUniformValue("uObjectId", 0.0f);
+    frameStateChanges += 4;
+    bindVao(&roomVao);
+    glDrawArrays(GL_TRIANGLES, 0, 6); // 바닥만 (트레이서에는 벽이 없음)
+
+    if (usePagedMesh) {
+        drawPagedCows(viewProjection);
+    } else if (cowVertexCount > 0) {
+        bindVao(&cowVao);
+        for (int cow = 0; cow < 2; ++cow) {
+            surfaceProgram->setUniformValue("uObjectId", float(cow + 1)); // syncTracerInstances()와 같은 id
+            ++frameStateChanges;
+            drawCow(cowModelMatrix(cow));
         }
-        return color;
     }
 
-    // 소일 경우
-    if (!isInShadow(hit.position, lightPos)) {
-        float diffuse = std::max(QVector3D::dotProduct(hit.normal.normalized(), lightDir), 0.0f);
-        color += diffuse * QVector3D(1.0f, 1.0f, 1.0f); // 흰색광
+    FrameArena& arena = FrameArena::local();
+    float* position = arena.allocateArray<float>(size_t(w) * h * 4);
+    float* normal = arena.allocateArray<float>(size_t(w) * h * 4);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_FLOAT, position);
+    glReadBuffer(GL_COLOR_ATTACHMENT1);
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_FLOAT, normal);
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    frameStateChanges += 4;
+
+    surfaces.width = w;
+    surfaces.height = h;
+    surfaces.position = position;
+    surfaces.normal = normal;
+}
+
+// G-buffer 대상은 크기가 바뀔 때만 다시 만듦
+void OpenGLWindow::resizeSurfaceTargets(int w, int h) {
+    if (!surfaceFbo) {
+        glGenFramebuffers(1, &surfaceFbo);
+        glGenTextures(2, surfaceTextures);
+        glGenRenderbuffers(1, &surfaceDepth);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, surfaceFbo);
+    for (int i = 0; i < 2; ++i) {
+        glBindTexture(GL_TEXTURE_2D, surfaceTextures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, w, h, 0, GL_RGBA, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, surfaceTextures[i], 0);
     }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    cowTextureBound = false;
 
-    // 반사
-    QVector3D reflectDir = ray.direction - 2.0f * QVector3D::dotProduct(ray.direction, hit.normal) * hit.normal;
-    reflectDir.normalize();
+    glBindRenderbuffer(GL_RENDERBUFFER, surfaceDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, w, h);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, surfaceDepth);
 
-    if (!std::isnan(reflectDir.x())) {
-        Ray reflectRay;
-        reflectRay.origin = hit.position + hit.normal * 0.01f;
-        reflectRay.direction = reflectDir;
-        QVector3D reflectColor = traceRecursive(reflectRay, depth + 1);
-        color += 0.5f * reflectColor;
+    const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Hybrid G-buffer framebuffer is incomplete" << std::endl;
     }
+    glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+    surfaceSize = QSize(w, h);
+}
 
-    return color;
+// 바운딩 박스의 8개 꼭짓점이 모두 같은 클립 평면 바깥이면 안 보임
+static bool boxInFrustum(const QMatrix4x4& mvp, const Vertex& lo, const Vertex& hi) {
+    int outside[6] = { 0, 0, 0, 0, 0, 0 };
+    for (int corner = 0; corner < 8; ++corner) {
+        QVector4D p = mvp * QVector4D(corner & 1 ? hi.x : lo.x, corner & 2 ? hi.y : lo.y, corner & 4 ? hi.z : lo.z, 1.0f);
+        outside[0] += p.x() < -p.w();
+        outside[1] += p.x() > p.w();
+        outside[2] += p.y() < -p.w();
+        outside[3] += p.y() > p.w();
+        outside[4] += p.z() < -p.w();
+        outside[5] += p.z() > p.w();
+    }
+    for (int plane = 0; plane < 6; ++plane) {
+        if (outside[plane] == 8) return false;
+    }
+    return true;
 }
 
+// 페이지 메쉬: 보이는 페이지만 GPU 페이지 캐시에서 그림
+// viewProjection은 컬링용 (G-buffer 패스는 트레이서 카메라)
+void OpenGLWindow::drawPagedCows(const QMatrix4x4& viewProjection) {
+    ++pagedFrame;
+    for (int cow = 0; cow < 2; ++cow) {
+        const QMatrix4x4 model = cowModelMatrix(cow);
+        const QMatrix4x4 mvp = viewProjection * model;
+        boundProgram->setUniformValue("uModel", model);
+        boundProgram->setUniformValue("uNormalMatrix", model.normalMatrix());
+        frameStateChanges += 2;
+        if (boundProgram == surfaceProgram) {
+            boundProgram->setUniformValue("uObjectId", float(cow + 1)); // syncTracerInstances()와 같은 id
+            ++frameStateChanges;
+        }
+
+        for (int p = 0; p < pagedMesh.pageCount(); ++p) {
+            const PagedMesh::PageInfo& info = pagedMesh.page(p);
+            if (!boxInFrustum(mvp, info.boundsMin, info.boundsMax)) continue;
+            GpuPage& page = gpuPage(p);
+            bindVao(page.vao.get());
+            glDrawArrays(GL_TRIANGLES, 0, page.vertexCount);
+        }
+    }
+}
 
+// GPU에 없는 페이지는 CPU 페이지 캐시에서 가져와 업로드
+// 예산을 넘으면 이번 프레임에 쓰지 않은 페이지 중 가장 오래된 것부터 해제
+OpenGLWindow::GpuPage& OpenGLWindow::gpuPage(int index) {
+    GpuPage& page = gpuPages[index];
+    page.lastUsedFrame = pagedFrame;
+    if (page.vao) return page;
+
+    std::shared_ptr<const PagedMesh::Page> data = pagedMesh.acquire(index);
+
+    // 인터리브 버퍼 (pos3, faceNormal3, vertexNormal3, uv2). 페이지에는 인접 정보가 없어 정점 법선 = 면 법선
+    std::vector<GLfloat> buffer;
+    buffer.reserve(data->triangles.size() * 3 * 11);
+    for (const PagedMesh::Triangle& t : data->triangles) {
+        QVector3D n = QVector3D::normal(QVector3D(t.v1.x - t.v0.x, t.v1.y - t.v0.y, t.v1.z - t.v0.z),
+                                        QVector3D(t.v2.x - t.v0.x, t.v2.y - t.v0.y, t.v2.z - t.v0.z));
+        for (const Vertex& v : { t.v0, t.v1, t.v2 }) {
+            buffer.insert(buffer.end(), {
+                v.x, v.y, v.z,
+                n.x(), n.y(), n.z(),
+                n.x(), n.y(), n.z(),
+                (v.x + 1.0f) * 0.5f, (v.z + 1.0f) * 0.5f
+            });
+        }
+    }
 
-// 전체 이미지 렌더링
-void OpenGLWindow::renderRayTracing() {
-    QImage image(width(), height(), QImage::Format_RGB32);
-    QVector3D modelOffset(0.0f, 0.0f, 0.0f);
-
-    for (int y = 0; y < height(); ++y) {
-        for (int x = 0; x < width(); ++x) {
-            float ndcX = (2.0f * x / width()) - 1.0f;
-            float ndcY = 1.0f - (2.0f * y / height());
-            QVector3D rayOrigin(0.0f, 3.0f, 10.0f);
-            QVector3D rayDir(ndcX, ndcY, -1.0f);
-            rayDir.normalize();
-
-            QVector3D color = traceRecursive(Ray{rayOrigin, rayDir}, 0);
-            int r = std::min(255, int(color.x() * 255));
-            int g = std::min(255, int(color.y() * 255));
-            int b = std::min(255, int(color.z() * 255));
-            image.setPixel(x, y, qRgb(r, g, b));
+    page.vao = std::make_unique<QOpenGLVertexArrayObject>();
+    page.vao->create();
+    page.vbo = QOpenGLBuffer();
+    page.vbo.create();
+    page.vertexCount = int(data->triangles.size() * 3);
+    page.bytes = buffer.size() * sizeof(GLfloat);
+
+    const int stride = 11 * sizeof(GLfloat);
+    page.vao->bind();
+    page.vbo.bind();
+    page.vbo.allocate(buffer.data(), int(page.bytes));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(3 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(6 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(9 * sizeof(GLfloat)));
+    page.vao->release();
+    page.vbo.release();
+    boundVao = nullptr;
+    ++frameStateChanges;
+
+    gpuPageBytes += page.bytes;
+    ++gpuPageUploads;
+    while (gpuPageBytes > gpuPageBudget) {
+        GpuPage* oldest = nullptr;
+        for (GpuPage& candidate : gpuPages) {
+            if (candidate.vao && candidate.lastUsedFrame != pagedFrame &&
+                (!oldest || candidate.lastUsedFrame < oldest->lastUsedFrame)) {
+                oldest = &candidate;
+            }
         }
+        if (!oldest) break; // 이번 프레임에 보이는 페이지만으로 예산 초과
+        releaseGpuPage(*oldest);
     }
+    return page;
+}
 
-    QPainter painter(this);
-    painter.drawImage(0, 0, image);
+void OpenGLWindow::releaseGpuPage(GpuPage& page) {
+    if (!page.vao) return;
+    if (boundVao == page.vao.get()) boundVao = nullptr;
+    page.vao->destroy();
+    page.vao.reset();
+    page.vbo.destroy();
+    gpuPageBytes -= page.bytes;
+    page.bytes = 0;
+    page.vertexCount = 0;
 }
 
+void OpenGLWindow::releaseGpuPages() {
+    for (GpuPage& page : gpuPages) releaseGpuPage(page);
+}
+
+// 페이지 캐시 상태가 바뀌었을 때만 출력
+void OpenGLWindow::reportPagedMesh() {
+    if (!usePagedMesh) return;
+    PagedMesh::Stats stats = pagedMesh.stats();
+    if (stats.misses == lastPageMisses && gpuPageUploads == lastGpuPageUploads) return;
+    lastPageMisses = stats.misses;
+    lastGpuPageUploads = gpuPageUploads;
+
+    const double mb = 1.0 / (1024.0 * 1024.0);
+    std::cout << "Mesh pages: resident " << stats.residentBytes * mb << " MB (peak " << stats.peakResidentBytes * mb
+              << " MB, budget " << stats.budgetBytes * mb << " MB), hits " << stats.hits << ", misses " << stats.misses
+              << ", evictions " << stats.evictions << "; GPU " << gpuPageBytes * mb << " MB, uploads " << gpuPageUploads
+              << std::endl;
+}
 
+QMatrix4x4 OpenGLWindow::cowModelMatrix(int index) const {
+    QMatrix4x4 model;
+    if (index == 0) {
+        model.translate(-2.5f, autoOffsetY, 0.0f);
+        model.rotate(cow1RotationX, 1.0f, 0.0f, 0.0f);
+        model.rotate(cow1RotationY, 0.0f, 1.0f, 0.0f);
+        model.rotate(cow1RotationZ, 0.0f, 0.0f, 1.0f);
+    } else {
+        model.translate(2.5f, autoOffsetY, 0.0f);
+        model.rotate(cow2RotationX, 1.0f, 0.0f, 0.0f);
+        model.rotate(cow2RotationY, 0.0f, 1.0f, 0.0f);
+        model.rotate(cow2RotationZ, 0.0f, 0.0f, 1.0f);
+    }
+    model.scale(0.3f);
+    return model;
+}
+
+void OpenGLWindow::syncTracerInstances() {
+    rayTracer.setInstances({ { cowModelMatrix(0), 1 }, { cowModelMatrix(1), 2 } });
+}
+
+void OpenGLWindow::syncTracerLights() {
+    // 트레이서는 GL 광원 색에 한 번만 배율을 곱함: 기본 광원 둘((2,2,2) + (1,1,0.5))을 더하면 흰색 1 근처
+    const float tracerLightScale = 1.0f / 3.0f;
+    std::vector<RayTracer::Light> lights;
+    if (light0On) {
+        lights.push_back({ QVector3D(light0Pos[0], light0Pos[1], light0Pos[2]),
+                           tracerLightScale * QVector3D(specularColor[0], specularColor[1], specularColor[2]) });
+    }
+    if (light1On) {
+        lights.push_back({ QVector3D(light1Pos[0], light1Pos[1], light1Pos[2]),
+                           tracerLightScale * QVector3D(light1Diffuse[0], light1Diffuse[1], light1Diffuse[2]) });
+    }
+    rayTracer.setLights(lights);
+}
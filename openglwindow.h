@@ -2,7 +2,10 @@
 #define OPENGLWINDOW_H
 
 #include <QOpenGLWidget>
-#include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
 #include <QMouseEvent>
 
 #include <QImage>
@@ -16,12 +19,19 @@
 
 #include <QPainter>
 #include <QVector3D>
+#include <QMatrix4x4>
+#include <QVector4D>
 #include <cmath>
+#include <memory>
 
 
 #include "objloader.h"
+#include "raytracer.h"
+#include "temporalcache.h"
+#include "framearena.h"
+#include "pagedmesh.h"
 
-class OpenGLWindow : public QOpenGLWidget, protected QOpenGLFunctions
+class OpenGLWindow : public QOpenGLWidget, protected QOpenGLExtraFunctions
 {
     Q_OBJECT
 
@@ -30,6 +40,24 @@ public:
     ~OpenGLWindow();
 
     void loadModel(const std::string& filename);
+    // PagedMesh::convert()로 만든 페이지 파일 (CPU 페이지 캐시와 GPU 페이지 캐시가 각각 예산만큼)
+    bool loadPagedModel(const std::string& path, size_t memoryBudgetBytes);
+
+    // 헤드리스 회귀 테스트용
+    void setRayTracing(bool enabled);
+    void setHybrid(bool enabled);
+    void setDenoise(bool enabled);
+    // 바닥 라이트맵 해상도 (월드 단위당 텍셀 수, 0이면 끄고 바닥마다 섀도우 레이)
+    void setLightmapDensity(float texelsPerUnit);
+    // 레이 트레이싱/하이브리드 프레임마다 시간 출력 (기본은 끔)
+    void setVerbose(bool enabled) { verbose = enabled; }
+    const RayTracer& tracer() const { return rayTracer; }
+
+public slots:
+    // 셰이딩 모드 전환
+    void setFlatShading();
+    void setGouraudShading();
+    void setPhongShading();
 
 protected:
     void initializeGL() override;
@@ -45,10 +73,10 @@ private slots: //assignment3 - 1
     void toggleLight0(bool enabled);
     void toggleLight1(bool enabled);
 
-
-    // 셰이딩 모드 전환
-    void setFlatShading();
-    void setGouraudShading();
+    // 레이 트레이싱 옵션
+    void toggleSoftShadows(bool enabled);
+    void toggleDenoise(bool enabled);
+    void toggleHybrid(bool enabled);
 
     // Ambient RGBA 조절
     void updateAmbientR(int value);
@@ -92,7 +120,8 @@ private:
     // 소 + 환경 그리기
     float autoOffsetY = 0.0f;
 
-    void drawCow();
+    QMatrix4x4 cowModelMatrix(int index) const; // 0: 왼쪽, 1: 오른쪽 (GL/트레이서 공용)
+    void drawCow(const QMatrix4x4& model);
     void drawFloorAndWalls();
 
     // 조명 상태
@@ -108,15 +137,73 @@ private:
     GLfloat ambientLight[4] = { 0.3f, 0.3f, 0.3f, 1.0f };
     GLfloat specularColor[4] = { 2.0f, 2.0f, 2.0f, 1.0f };
 
+    // 재질 (고정 파이프라인 기본값과 동일: 스페큘러 하이라이트 없음, w = shininess)
+    GLfloat materialSpecular[4] = { 0.0f, 0.0f, 0.0f, 32.0f };
+
     // 셰이딩 모드
-    GLenum shadingModel = GL_SMOOTH;
+    enum class ShadingMode { Flat, Gouraud, Phong };
+    ShadingMode shadingMode = ShadingMode::Gouraud;
+
+    // === GLSL 파이프라인 ===
+    // std140 레이아웃의 SceneUniforms 블록과 1:1 대응
+    struct SceneUniforms {
+        GLfloat viewProjection[16];
+        GLfloat eyePosition[4];
+        GLfloat lightPosition[2][4];
+        GLfloat lightDiffuse[2][4];
+        GLfloat lightSpecular[2][4];
+        GLfloat ambientLight[4];
+        GLfloat materialSpecular[4];
+        GLint lightEnabled[4];
+    };
+
+    QOpenGLShaderProgram* flatProgram = nullptr;
+    QOpenGLShaderProgram* gouraudProgram = nullptr;
+    QOpenGLShaderProgram* phongProgram = nullptr;
+    QOpenGLShaderProgram* unlitProgram = nullptr; // 바닥/벽
+    bool rasterReady = false; // 래스터 셰이더가 모두 링크됨
+
+    GLuint sceneUbo = 0;
+    QOpenGLVertexArrayObject cowVao;
+    QOpenGLBuffer cowVbo;
+    int cowVertexCount = 0;
+    QOpenGLVertexArrayObject roomVao;
+    QOpenGLBuffer roomVbo;
+    int roomVertexCount = 0;
+
+    // 더티 플래그: UI 슬롯은 값만 바꾸고 GL 호출은 paintGL에서 한 번만
+    bool sceneUniformsDirty = true;
+    bool cowMeshDirty = false;
+    bool glStateLost = true; // QPainter 사용 후 GL 상태 재설정 필요
+
+    // 프레임당 GL 상태 변경 카운트
+    QOpenGLShaderProgram* boundProgram = nullptr;
+    QOpenGLVertexArrayObject* boundVao = nullptr;
+    bool cowTextureBound = false;
+    int frameStateChanges = 0;
+    int lastFrameStateChanges = -1;
+
+    QOpenGLShaderProgram* createProgram(const char* define, const char* vertexSource, const char* fragmentSource);
+    QOpenGLShaderProgram* currentLitProgram() const;
+    void useProgram(QOpenGLShaderProgram* program);
+    void bindVao(QOpenGLVertexArrayObject* vao);
+    QMatrix4x4 viewProjectionMatrix() const;
+    void restoreGlState(); // QPainter 블릿 후 한 번
+    void uploadSceneUniforms();
+    void uploadCowMesh();
+    void createRoomMesh();
+    void reportStateChanges();
 
     // UI 구성 요소
     QCheckBox* light0Checkbox;
     QCheckBox* light1Checkbox;
+    QCheckBox* softShadowCheckbox;
+    QCheckBox* denoiseCheckbox;
+    QCheckBox* hybridCheckbox;
 
     QPushButton* flatButton;
     QPushButton* gouraudButton;
+    QPushButton* phongButton;
 
     QSlider* ambientRSlider;
     QSlider* ambientGSlider;
@@ -131,28 +218,59 @@ private:
     void setupUI(); // UI 초기화 함수
 
     // === Ray Tracing ===
-    struct Ray {
-        QVector3D origin;
-        QVector3D direction;
-    };
-
-    struct HitInfo {
-        float distance;
-        QVector3D position;
-        QVector3D normal;
-        bool hit = false;
-        int objectId = -1;
-    };
-
     bool useRayTracing = true;
-    int maxDepth = 3;
-    QVector3D lightPos = QVector3D(5.0f, 5.0f, 5.0f);
+    RayTracer rayTracer{objLoader};
+    TemporalCache temporalCache; // 소를 돌릴 때 영향받는 픽셀만 다시 추적
+    QImage rayTraceImage; // 크기가 바뀔 때만 재할당
 
-    bool intersectRayTriangle(const Ray& ray, const QVector3D& v0, const QVector3D& v1, const QVector3D& v2, float& t, QVector3D& normal);
-    HitInfo traceRay(const Ray& ray);
-    bool isInShadow(const QVector3D& point, const QVector3D& lightPos);
-    QVector3D traceRecursive(const Ray& ray, int depth);
     void renderRayTracing();
+    void reportLightmap(const RayTracer::RenderStats& stats);
+
+    // === 하이브리드 (래스터화한 1차 가시성 + 레이 트레이싱한 그림자/반사) ===
+    // G-buffer: 위치 + objectId, 면 법선 (RGBA32F 두 장) + 깊이. 트레이서 카메라와 같은 투영
+    bool useHybrid = false;
+    QOpenGLShaderProgram* surfaceProgram = nullptr;
+    GLuint surfaceFbo = 0;
+    GLuint surfaceTextures[2] = { 0, 0 };
+    GLuint surfaceDepth = 0;
+    QSize surfaceSize;
+
+    void renderHybrid();
+    void rasterizeSurfaces(RayTracer::PrimarySurfaces& surfaces);
+    void resizeSurfaceTargets(int w, int h);
+    void syncTracerLights(); // GL 광원 상태(on/off, 위치, 색) → 트레이서 광원 목록
+    void syncTracerInstances(); // 소 두 마리의 모델 행렬 → 트레이서 인스턴스
+
+    // === 페이지 메쉬 (out-of-core) ===
+    struct GpuPage {
+        std::unique_ptr<QOpenGLVertexArrayObject> vao; // 없으면 GPU에 없음
+        QOpenGLBuffer vbo;
+        int vertexCount = 0;
+        size_t bytes = 0;
+        unsigned lastUsedFrame = 0;
+    };
+
+    PagedMesh pagedMesh;
+    bool usePagedMesh = false;
+    std::vector<GpuPage> gpuPages; // 페이지 번호별
+    size_t gpuPageBytes = 0;
+    size_t gpuPageBudget = size_t(256) << 20;
+    unsigned pagedFrame = 0;
+    uint64_t gpuPageUploads = 0;
+    uint64_t lastPageMisses = ~uint64_t(0);
+    uint64_t lastGpuPageUploads = ~uint64_t(0);
+
+    void drawPagedCows(const QMatrix4x4& viewProjection);
+    GpuPage& gpuPage(int index);
+    void releaseGpuPage(GpuPage& page);
+    void releaseGpuPages();
+    void reportPagedMesh();
+
+    // 프레임당 힙 할당 수 (steady state에서 0이어야 함)
+    size_t frameAllocationStart = 0;
+    long long lastFrameAllocations = -1;
+    bool verbose = false;
+    void reportFrameAllocations();
 };
 
 #endif // OPENGLWINDOW_H
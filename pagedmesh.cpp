@@ -0,0 +1,515 @@
+#include "pagedmesh.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+struct PagedMesh::Residency {
+    std::atomic<size_t> bytes{0};
+    std::atomic<size_t> peak{0};
+
+    void add(size_t amount) {
+        size_t now = bytes.fetch_add(amount) + amount;
+        size_t previous = peak.load();
+        while (now > previous && !peak.compare_exchange_weak(previous, now)) {}
+    }
+};
+
+PagedMesh::Page::~Page() {
+    if (residency) residency->bytes.fetch_sub(triangles.size() * sizeof(Triangle));
+}
+
+namespace {
+
+const char kMagic[8] = { 'C', 'O', 'W', 'P', 'A', 'G', 'E', 'S' };
+const uint32_t kVersion = 1;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t pageCount;
+    uint64_t triangleCount;
+    Vertex boundsMin;
+    Vertex boundsMax;
+    uint64_t tableOffset;
+};
+
+// 첫 버킷 격자 (BUCKET_GRID^3개 임시 파일). 예산보다 큰 버킷은 자기 중심점 박스로 8등분을 반복
+const int BUCKET_GRID = 4;
+
+// 변환 중의 버킷 하나 (임시 파일 + 안에 든 삼각형 중심점의 박스)
+struct Bucket {
+    std::string path;
+    uint64_t count = 0;
+    Vertex centroidMin;
+    Vertex centroidMax;
+    bool splittable = true; // 나눠도 한쪽으로 다 몰리면 false (같은 중심점이 예산보다 많음)
+};
+
+void growBounds(Vertex& boundsMin, Vertex& boundsMax, const Vertex& v) {
+    boundsMin.x = std::min(boundsMin.x, v.x);
+    boundsMin.y = std::min(boundsMin.y, v.y);
+    boundsMin.z = std::min(boundsMin.z, v.z);
+    boundsMax.x = std::max(boundsMax.x, v.x);
+    boundsMax.y = std::max(boundsMax.y, v.y);
+    boundsMax.z = std::max(boundsMax.z, v.z);
+}
+
+// 10비트 정수의 비트 사이에 0 두 개씩 (Morton 코드)
+uint32_t expandBits(uint32_t v) {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+Vertex centroid(const PagedMesh::Triangle& t) {
+    return { (t.v0.x + t.v1.x + t.v2.x) / 3.0f, (t.v0.y + t.v1.y + t.v2.y) / 3.0f, (t.v0.z + t.v1.z + t.v2.z) / 3.0f };
+}
+
+Vertex safeExtent(const Vertex& boundsMin, const Vertex& boundsMax) {
+    return { std::max(boundsMax.x - boundsMin.x, 1e-6f), std::max(boundsMax.y - boundsMin.y, 1e-6f),
+             std::max(boundsMax.z - boundsMin.z, 1e-6f) };
+}
+
+// 박스 안에서 [0, 1]로 정규화한 중심점
+void normalizedCentroid(const PagedMesh::Triangle& t, const Vertex& boundsMin, const Vertex& extent, float out[3]) {
+    Vertex c = centroid(t);
+    out[0] = (c.x - boundsMin.x) / extent.x;
+    out[1] = (c.y - boundsMin.y) / extent.y;
+    out[2] = (c.z - boundsMin.z) / extent.z;
+}
+
+uint32_t mortonCode(const float p[3]) {
+    uint32_t code = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        uint32_t q = uint32_t(std::min(1023.0f, std::max(0.0f, p[axis] * 1024.0f)));
+        code |= expandBits(q) << (2 - axis);
+    }
+    return code;
+}
+
+// OBJ 인덱스 하나 ("7", "7/1", "7//3", "-1") → 0 기반, 실패하면 -1
+long long parseIndex(const char*& p, uint64_t vertexCount) {
+    char* end;
+    long long index = std::strtoll(p, &end, 10);
+    if (end == p) return -1;
+    p = end;
+    while (*p && *p != ' ' && *p != '\t') ++p; // /uv/normal 건너뛰기
+    if (index < 0) index += (long long)vertexCount;
+    else index -= 1;
+    return index;
+}
+
+} // namespace
+
+bool PagedMesh::convert(const std::string& objPath, const std::string& pagesPath, int trianglesPerPage,
+                        size_t memoryBudget) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    trianglesPerPage = std::max(64, trianglesPerPage);
+    // 한 번에 메모리에 올리는 삼각형 수 (삼각형 + 정렬 키)
+    const uint64_t bucketLimit = std::max<uint64_t>(uint64_t(trianglesPerPage),
+                                                    memoryBudget / (sizeof(Triangle) + sizeof(std::pair<uint32_t, uint32_t>)));
+
+    std::ifstream fin(objPath);
+    if (!fin.is_open()) {
+        std::cerr << "Failed to open file: " << objPath << std::endl;
+        return false;
+    }
+
+    const std::string vertexPath = pagesPath + ".vertices.tmp";
+    const std::string facePath = pagesPath + ".faces.tmp";
+    std::vector<std::string> bucketFiles;
+    auto newBucket = [&] {
+        Bucket bucket;
+        bucket.path = pagesPath + ".bucket" + std::to_string(bucketFiles.size()) + ".tmp";
+        bucket.centroidMin = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+        bucket.centroidMax = { -bucket.centroidMin.x, -bucket.centroidMin.y, -bucket.centroidMin.z };
+        bucketFiles.push_back(bucket.path);
+        return bucket;
+    };
+    auto removeTemporaries = [&] {
+        std::remove(vertexPath.c_str());
+        std::remove(facePath.c_str());
+        for (const std::string& path : bucketFiles) std::remove(path.c_str());
+    };
+
+    // (1) OBJ 한 번 읽기: 정점/면 인덱스를 그대로 임시 파일로 (메모리에는 줄 하나만)
+    const float inf = std::numeric_limits<float>::max();
+    Vertex boundsMin{inf, inf, inf};
+    Vertex boundsMax{-inf, -inf, -inf};
+    uint64_t vertexCount = 0;
+    uint64_t faceCount = 0;
+    {
+        std::ofstream vertexOut(vertexPath, std::ios::binary);
+        std::ofstream faceOut(facePath, std::ios::binary);
+        if (!vertexOut || !faceOut) {
+            std::cerr << "Failed to create temporary files next to " << pagesPath << std::endl;
+            return false;
+        }
+
+        std::string line;
+        while (std::getline(fin, line)) {
+            if (line.size() < 2 || (line[1] != ' ' && line[1] != '\t')) continue;
+            const char* p = line.c_str() + 2;
+            if (line[0] == 'v') {
+                char* end;
+                Vertex v;
+                v.x = std::strtof(p, &end); p = end;
+                v.y = std::strtof(p, &end); p = end;
+                v.z = std::strtof(p, &end);
+                vertexOut.write(reinterpret_cast<const char*>(&v), sizeof(v));
+                growBounds(boundsMin, boundsMax, v);
+                ++vertexCount;
+            } else if (line[0] == 'f') {
+                // 다각형은 부채꼴로 삼각형 분할
+                long long first = parseIndex(p, vertexCount);
+                long long previous = parseIndex(p, vertexCount);
+                long long current;
+                if (first < 0 || previous < 0) continue;
+                while ((current = parseIndex(p, vertexCount)) >= 0) {
+                    uint32_t indices[3] = { uint32_t(first), uint32_t(previous), uint32_t(current) };
+                    faceOut.write(reinterpret_cast<const char*>(indices), sizeof(indices));
+                    ++faceCount;
+                    previous = current;
+                }
+            }
+        }
+    }
+    fin.close();
+    if (vertexCount == 0 || faceCount == 0) {
+        std::cerr << "No triangles in " << objPath << std::endl;
+        removeTemporaries();
+        return false;
+    }
+
+    // (2) 면을 격자 버킷으로 분배 (정점은 메모리 맵으로 임의 접근, OS가 페이징)
+    Vertex extent = safeExtent(boundsMin, boundsMax);
+    const int bucketCount = BUCKET_GRID * BUCKET_GRID * BUCKET_GRID;
+    std::vector<Bucket> grid;
+    for (int b = 0; b < bucketCount; ++b) grid.push_back(newBucket());
+    {
+        QFile vertexFile(QString::fromStdString(vertexPath));
+        if (!vertexFile.open(QIODevice::ReadOnly)) {
+            removeTemporaries();
+            return false;
+        }
+        const Vertex* mapped = reinterpret_cast<const Vertex*>(vertexFile.map(0, vertexFile.size()));
+        if (!mapped) {
+            std::cerr << "Failed to map " << vertexPath << std::endl;
+            removeTemporaries();
+            return false;
+        }
+
+        std::vector<std::ofstream> buckets(bucketCount);
+        for (int b = 0; b < bucketCount; ++b) buckets[b].open(grid[b].path, std::ios::binary);
+
+        std::ifstream faceIn(facePath, std::ios::binary);
+        std::vector<uint32_t> block(3 * 65536);
+        while (faceIn) {
+            faceIn.read(reinterpret_cast<char*>(block.data()), std::streamsize(block.size() * sizeof(uint32_t)));
+            size_t read = size_t(faceIn.gcount()) / (3 * sizeof(uint32_t));
+            for (size_t f = 0; f < read; ++f) {
+                const uint32_t* idx = &block[f * 3];
+                if (idx[0] >= vertexCount || idx[1] >= vertexCount || idx[2] >= vertexCount) continue;
+                Triangle t{ mapped[idx[0]], mapped[idx[1]], mapped[idx[2]] };
+
+                float p[3];
+                normalizedCentroid(t, boundsMin, extent, p);
+                int cell[3];
+                for (int axis = 0; axis < 3; ++axis) {
+                    cell[axis] = std::min(BUCKET_GRID - 1, std::max(0, int(p[axis] * BUCKET_GRID)));
+                }
+                int bucket = (cell[2] * BUCKET_GRID + cell[1]) * BUCKET_GRID + cell[0];
+                buckets[bucket].write(reinterpret_cast<const char*>(&t), sizeof(t));
+                growBounds(grid[bucket].centroidMin, grid[bucket].centroidMax, centroid(t));
+                ++grid[bucket].count;
+            }
+        }
+        vertexFile.unmap(reinterpret_cast<uchar*>(const_cast<Vertex*>(mapped)));
+    }
+    std::remove(vertexPath.c_str());
+    std::remove(facePath.c_str());
+
+    // (3) 버킷마다 Morton 순서로 정렬해서 페이지로 자름
+    //     예산보다 큰 버킷은 먼저 8등분 (깊이 우선, 자식도 Morton 순서라 페이지 순서가 공간 순서로 이어짐)
+    std::ofstream out(pagesPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Failed to write " << pagesPath << std::endl;
+        removeTemporaries();
+        return false;
+    }
+    FileHeader header{};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header)); // 나중에 덮어씀
+
+    std::vector<PageInfo> table;
+    uint64_t triangleCount = 0;
+    uint64_t offset = sizeof(header);
+    int splits = 0;
+    std::vector<Triangle> triangles;
+    std::vector<std::pair<uint32_t, uint32_t>> order; // (Morton, 버킷 내 인덱스)
+    std::vector<Bucket> pending(grid.rbegin(), grid.rend());
+    while (!pending.empty()) {
+        Bucket bucket = pending.back();
+        pending.pop_back();
+        std::ifstream bucketIn(bucket.path, std::ios::binary);
+
+        if (bucket.count > bucketLimit && bucket.splittable) {
+            Vertex mid{ (bucket.centroidMin.x + bucket.centroidMax.x) * 0.5f,
+                        (bucket.centroidMin.y + bucket.centroidMax.y) * 0.5f,
+                        (bucket.centroidMin.z + bucket.centroidMax.z) * 0.5f };
+            Bucket children[8];
+            std::ofstream childOut[8];
+            for (int c = 0; c < 8; ++c) {
+                children[c] = newBucket();
+                childOut[c].open(children[c].path, std::ios::binary);
+            }
+            triangles.resize(65536);
+            while (bucketIn) {
+                bucketIn.read(reinterpret_cast<char*>(triangles.data()), std::streamsize(triangles.size() * sizeof(Triangle)));
+                size_t read = size_t(bucketIn.gcount()) / sizeof(Triangle);
+                for (size_t i = 0; i < read; ++i) {
+                    Vertex c = centroid(triangles[i]);
+                    int child = (c.x > mid.x ? 4 : 0) | (c.y > mid.y ? 2 : 0) | (c.z > mid.z ? 1 : 0); // mortonCode와 같은 축 순서
+                    childOut[child].write(reinterpret_cast<const char*>(&triangles[i]), sizeof(Triangle));
+                    growBounds(children[child].centroidMin, children[child].centroidMax, c);
+                    ++children[child].count;
+                }
+            }
+            bucketIn.close();
+            std::remove(bucket.path.c_str());
+            for (int c = 7; c >= 0; --c) {
+                childOut[c].close();
+                children[c].splittable = children[c].count < bucket.count;
+                if (children[c].count > 0) pending.push_back(children[c]);
+                else std::remove(children[c].path.c_str());
+            }
+            ++splits;
+            continue;
+        }
+
+        // 메모리에 올릴 수 있는 만큼씩 (더 못 나누는 버킷만 여러 번)
+        Vertex bucketExtent = safeExtent(bucket.centroidMin, bucket.centroidMax);
+        for (uint64_t done = 0; done < bucket.count;) {
+            triangles.resize(size_t(std::min(bucketLimit, bucket.count - done)));
+            bucketIn.read(reinterpret_cast<char*>(triangles.data()), std::streamsize(triangles.size() * sizeof(Triangle)));
+            size_t read = size_t(bucketIn.gcount()) / sizeof(Triangle);
+            if (read == 0) break;
+            triangles.resize(read);
+            done += read;
+
+            order.resize(triangles.size());
+            for (size_t i = 0; i < triangles.size(); ++i) {
+                float p[3];
+                normalizedCentroid(triangles[i], bucket.centroidMin, bucketExtent, p);
+                order[i] = { mortonCode(p), uint32_t(i) };
+            }
+            std::sort(order.begin(), order.end());
+
+            for (size_t begin = 0; begin < order.size(); begin += trianglesPerPage) {
+                size_t end = std::min(order.size(), begin + size_t(trianglesPerPage));
+                PageInfo info{ offset, uint32_t(end - begin), {inf, inf, inf}, {-inf, -inf, -inf} };
+                for (size_t i = begin; i < end; ++i) {
+                    const Triangle& t = triangles[order[i].second];
+                    growBounds(info.boundsMin, info.boundsMax, t.v0);
+                    growBounds(info.boundsMin, info.boundsMax, t.v1);
+                    growBounds(info.boundsMin, info.boundsMax, t.v2);
+                    out.write(reinterpret_cast<const char*>(&t), sizeof(t));
+                }
+                offset += uint64_t(info.triangleCount) * sizeof(Triangle);
+                triangleCount += info.triangleCount;
+                table.push_back(info);
+            }
+        }
+        bucketIn.close();
+        std::remove(bucket.path.c_str());
+    }
+    triangles = std::vector<Triangle>();
+    order = std::vector<std::pair<uint32_t, uint32_t>>();
+
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.pageCount = uint32_t(table.size());
+    header.triangleCount = triangleCount;
+    header.boundsMin = boundsMin;
+    header.boundsMax = boundsMax;
+    header.tableOffset = offset;
+    out.write(reinterpret_cast<const char*>(table.data()), std::streamsize(table.size() * sizeof(PageInfo)));
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if (!out) {
+        std::cerr << "Failed to write " << pagesPath << std::endl;
+        return false;
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "Converted " << objPath << ": " << vertexCount << " vertices, " << triangleCount << " triangles → "
+              << table.size() << " pages of up to " << trianglesPerPage << " (" << splits << " bucket splits) in "
+              << seconds << " s" << std::endl;
+    return true;
+}
+
+bool PagedMesh::open(const std::string& path) {
+    std::lock_guard<std::mutex> fileLock(fileMutex);
+    std::lock_guard<std::mutex> cacheLock(cacheMutex);
+
+    pages.clear();
+    cache.clear();
+    lru.clear();
+    cachedBytes = 0;
+    hits = misses = evictions = 0;
+    static std::atomic<unsigned> nextGeneration{1};
+    residency = std::make_shared<Residency>();
+    generation = nextGeneration++;
+
+    if (file.is_open()) file.close();
+    file.clear();
+    file.open(path, std::ios::binary);
+    auto fail = [&](const char* reason) {
+        std::cerr << reason << ": " << path << std::endl;
+        pages.clear();
+        file.close();
+        return false;
+    };
+
+    FileHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+        return fail("Not a page file");
+    }
+
+    // 헤더/페이지 테이블이 파일 밖을 가리키면 열지 않음 (acquire()의 resize가 믿는 값)
+    file.seekg(0, std::ios::end);
+    const uint64_t fileSize = uint64_t(file.tellg());
+    if (header.tableOffset < sizeof(header) || header.tableOffset > fileSize ||
+        header.pageCount > (fileSize - header.tableOffset) / sizeof(PageInfo)) {
+        return fail("Page table out of range");
+    }
+
+    pages.resize(header.pageCount);
+    file.seekg(std::streamoff(header.tableOffset));
+    if (!file.read(reinterpret_cast<char*>(pages.data()), std::streamsize(pages.size() * sizeof(PageInfo)))) {
+        return fail("Truncated page table");
+    }
+
+    uint64_t pagedTriangles = 0;
+    for (const PageInfo& info : pages) {
+        if (info.offset < sizeof(header) || info.offset > header.tableOffset ||
+            info.triangleCount > (header.tableOffset - info.offset) / sizeof(Triangle)) {
+            return fail("Page out of range");
+        }
+        pagedTriangles += info.triangleCount;
+    }
+    if (pagedTriangles != header.triangleCount) {
+        return fail("Page table does not match triangle count");
+    }
+    cache.resize(pages.size());
+    totalTriangles = header.triangleCount;
+    meshBoundsMin = header.boundsMin;
+    meshBoundsMax = header.boundsMax;
+
+    std::cout << "Page file opened: " << path << " (" << totalTriangles << " triangles, "
+              << pages.size() << " pages)" << std::endl;
+    return true;
+}
+
+void PagedMesh::setMemoryBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    budgetBytes = bytes;
+}
+
+std::shared_ptr<const PagedMesh::Page> PagedMesh::acquire(int index) const {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        CacheSlot& slot = cache[index];
+        if (slot.page) {
+            ++hits;
+            lru.splice(lru.begin(), lru, slot.position);
+            return slot.page;
+        }
+        ++misses;
+    }
+
+    // 디스크 읽기는 캐시 락 밖에서 (다른 스레드의 캐시 히트를 막지 않도록)
+    const PageInfo& info = pages[index];
+    auto page = std::make_shared<Page>();
+    page->triangles.resize(info.triangleCount);
+    page->residency = residency;
+    const size_t bytes = page->triangles.size() * sizeof(Triangle);
+    residency->add(bytes);
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        file.clear();
+        file.seekg(std::streamoff(info.offset));
+        file.read(reinterpret_cast<char*>(page->triangles.data()), std::streamsize(bytes));
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    CacheSlot& slot = cache[index];
+    if (slot.page) return slot.page; // 그 사이 다른 스레드가 먼저 읽음
+
+    slot.page = page;
+    slot.bytes = bytes;
+    lru.push_front(index);
+    slot.position = lru.begin();
+    cachedBytes += bytes;
+
+    // 예산을 넘으면 오래된 페이지부터 내보냄 (방금 읽은 페이지는 유지)
+    while (cachedBytes > budgetBytes && lru.size() > 1) {
+        CacheSlot& victim = cache[lru.back()];
+        lru.pop_back();
+        cachedBytes -= victim.bytes;
+        victim.page.reset();
+        ++evictions;
+    }
+    return page;
+}
+
+namespace {
+
+struct PinSlot {
+    const PagedMesh* mesh = nullptr;
+    unsigned generation = 0;
+    int index = -1;
+    std::shared_ptr<const PagedMesh::Page> page;
+};
+
+const int PIN_SLOTS = 8;
+thread_local PinSlot pinSlots[PIN_SLOTS];
+
+} // namespace
+
+const PagedMesh::Page& PagedMesh::pin(int index) const {
+    PinSlot& slot = pinSlots[index % PIN_SLOTS];
+    if (slot.mesh != this || slot.generation != generation || slot.index != index) {
+        slot.page = acquire(index);
+        slot.mesh = this;
+        slot.generation = generation;
+        slot.index = index;
+    }
+    return *slot.page;
+}
+
+PagedMesh::Stats PagedMesh::stats() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    Stats s;
+    s.budgetBytes = budgetBytes;
+    s.cachedBytes = cachedBytes;
+    if (residency) {
+        s.residentBytes = residency->bytes.load();
+        s.peakResidentBytes = residency->peak.load();
+    }
+    s.hits = hits;
+    s.misses = misses;
+    s.evictions = evictions;
+    return s;
+}
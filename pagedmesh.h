@@ -0,0 +1,104 @@
+#ifndef PAGEDMESH_H
+#define PAGEDMESH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "objloader.h"
+
+// 메모리보다 큰 메쉬용 out-of-core 레이아웃
+// - convert(): OBJ를 한 번 읽으면서 공간적으로 모인 삼각형 페이지 파일로 변환
+//   (정점/면은 임시 파일로 흘려보내고, 격자 버킷 → 예산보다 큰 버킷은 8등분 반복 → 버킷 안에서 Morton 순서로 정렬 → 페이지)
+//   변환 중 메모리는 memoryBudget 정도 (한 번에 정렬하는 버킷 크기)
+// - 페이지마다 바운딩 박스가 있어 레이/프러스텀에 안 걸리는 페이지는 읽지 않음
+// - 읽은 페이지는 메모리 예산 안에서 LRU 캐시에 유지
+class PagedMesh {
+public:
+    // 페이지 안의 삼각형은 인덱스 없이 위치만 (페이지 하나로 완결)
+    struct Triangle {
+        Vertex v0, v1, v2;
+    };
+
+    struct PageInfo {
+        uint64_t offset;
+        uint32_t triangleCount;
+        Vertex boundsMin;
+        Vertex boundsMax;
+    };
+
+    // 상주 바이트 수 (페이지가 메쉬보다 오래 살 수 있어 따로 공유)
+    struct Residency;
+
+    // 메모리에 올라온 페이지. 캐시에서 밀려나도 쓰는 쪽이 있으면 그때까지 유지
+    struct Page {
+        std::vector<Triangle> triangles;
+        std::shared_ptr<Residency> residency;
+        ~Page();
+    };
+
+    struct Stats {
+        size_t budgetBytes = 0;
+        size_t cachedBytes = 0;       // LRU 캐시에 있는 페이지
+        size_t residentBytes = 0;     // 캐시 + 아직 쓰고 있는 밀려난 페이지
+        size_t peakResidentBytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;          // 디스크에서 읽은 횟수
+        uint64_t evictions = 0;
+    };
+
+    static bool convert(const std::string& objPath, const std::string& pagesPath, int trianglesPerPage = 16384,
+                        size_t memoryBudget = size_t(256) << 20);
+
+    bool open(const std::string& path);
+    bool isOpen() const { return !pages.empty(); }
+    void setMemoryBudget(size_t bytes);
+
+    int pageCount() const { return int(pages.size()); }
+    const PageInfo& page(int index) const { return pages[index]; }
+    uint64_t triangleCount() const { return totalTriangles; }
+    const Vertex& boundsMin() const { return meshBoundsMin; }
+    const Vertex& boundsMax() const { return meshBoundsMax; }
+
+    // 캐시에서 페이지를 가져옴 (없으면 디스크에서 읽음). 여러 스레드에서 호출 가능
+    std::shared_ptr<const Page> acquire(int index) const;
+
+    // 스레드별 최근 페이지 슬롯을 거쳐 가져옴 (캐시 락을 매 레이마다 잡지 않도록)
+    // 반환값은 같은 스레드의 다음 pin() 호출 전까지만 유효.
+    // 슬롯이 잡고 있는 페이지(스레드당 최대 8개)는 예산을 넘어도 해제되지 않음
+    const Page& pin(int index) const;
+
+    Stats stats() const;
+
+private:
+    struct CacheSlot {
+        std::shared_ptr<const Page> page;
+        std::list<int>::iterator position;
+        size_t bytes = 0;
+    };
+
+    std::vector<PageInfo> pages;
+    uint64_t totalTriangles = 0;
+    Vertex meshBoundsMin{0.0f, 0.0f, 0.0f};
+    Vertex meshBoundsMax{0.0f, 0.0f, 0.0f};
+    unsigned generation = 0; // open()마다 바뀜 (스레드 슬롯 무효화)
+
+    mutable std::ifstream file;
+    mutable std::mutex fileMutex;
+    mutable std::mutex cacheMutex;
+    mutable std::vector<CacheSlot> cache;
+    mutable std::list<int> lru; // 앞쪽이 최근
+    mutable size_t cachedBytes = 0;
+    size_t budgetBytes = size_t(256) << 20;
+    mutable uint64_t hits = 0;
+    mutable uint64_t misses = 0;
+    mutable uint64_t evictions = 0;
+    std::shared_ptr<Residency> residency;
+};
+
+#endif // PAGEDMESH_H
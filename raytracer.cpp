@@ -0,0 +1,736 @@
+#include "raytracer.h"
+#include "framearena.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+RayTracer::RayTracer(const ObjLoader& mesh)
+    : mesh(mesh)
+{
+    setLights({ { QVector3D(5.0f, 5.0f, 5.0f), QVector3D(1.0f, 1.0f, 1.0f) } });
+    setInstances({ { QMatrix4x4(), 1 } });
+}
+
+void RayTracer::setInstances(const std::vector<Instance>& instances) {
+    sceneInstances = instances;
+
+    // 오브젝트 공간 바운딩 박스 (인스턴스마다 레이를 변환해서 검사)
+    const float inf = std::numeric_limits<float>::max();
+    meshBoundsMin = QVector3D(inf, inf, inf);
+    meshBoundsMax = QVector3D(-inf, -inf, -inf);
+    if (pagedMesh) {
+        const Vertex& lo = pagedMesh->boundsMin();
+        const Vertex& hi = pagedMesh->boundsMax();
+        meshBoundsMin = QVector3D(lo.x, lo.y, lo.z);
+        meshBoundsMax = QVector3D(hi.x, hi.y, hi.z);
+    } else {
+        for (const auto& v : mesh.vertices) {
+            meshBoundsMin = QVector3D(std::min(meshBoundsMin.x(), v.x), std::min(meshBoundsMin.y(), v.y), std::min(meshBoundsMin.z(), v.z));
+            meshBoundsMax = QVector3D(std::max(meshBoundsMax.x(), v.x), std::max(meshBoundsMax.y(), v.y), std::max(meshBoundsMax.z(), v.z));
+        }
+    }
+
+    instanceData.clear();
+    instanceData.reserve(instances.size());
+    for (const Instance& instance : instances) {
+        QMatrix4x4 toObject = instance.transform.inverted();
+        instanceData.push_back({ toObject, toObject.transposed(), instance.objectId });
+    }
+}
+
+// 인스턴스 변환을 적용한 메쉬 바운딩 박스 (오브젝트 공간 박스의 8개 꼭짓점)
+void RayTracer::worldBounds(const QMatrix4x4& transform, QVector3D& boundsMin, QVector3D& boundsMax) const {
+    const float inf = std::numeric_limits<float>::max();
+    boundsMin = QVector3D(inf, inf, inf);
+    boundsMax = QVector3D(-inf, -inf, -inf);
+    for (int corner = 0; corner < 8; ++corner) {
+        QVector3D p = transform.map(QVector3D(corner & 1 ? meshBoundsMax.x() : meshBoundsMin.x(),
+                                              corner & 2 ? meshBoundsMax.y() : meshBoundsMin.y(),
+                                              corner & 4 ? meshBoundsMax.z() : meshBoundsMin.z()));
+        boundsMin = QVector3D(std::min(boundsMin.x(), p.x()), std::min(boundsMin.y(), p.y()), std::min(boundsMin.z(), p.z()));
+        boundsMax = QVector3D(std::max(boundsMax.x(), p.x()), std::max(boundsMax.y(), p.y()), std::max(boundsMax.z(), p.z()));
+    }
+}
+
+// 슬랩 테스트: [0, maxT) 안에서 박스와 만나는지 (direction은 정규화하지 않아도 됨)
+bool RayTracer::intersectBounds(const Ray& ray, const QVector3D& boundsMin, const QVector3D& boundsMax, float maxT) {
+    float entry;
+    return intersectBounds(ray, boundsMin, boundsMax, maxT, entry);
+}
+
+// entry: 박스에 들어가는 t (원점이 안에 있으면 0)
+bool RayTracer::intersectBounds(const Ray& ray, const QVector3D& boundsMin, const QVector3D& boundsMax, float maxT, float& entry) {
+    float tMin = 0.0f, tMax = maxT;
+    for (int axis = 0; axis < 3; ++axis) {
+        float inv = 1.0f / ray.direction[axis];
+        float t0 = (boundsMin[axis] - ray.origin[axis]) * inv;
+        float t1 = (boundsMax[axis] - ray.origin[axis]) * inv;
+        if (t0 > t1) std::swap(t0, t1);
+        tMin = std::max(tMin, t0);
+        tMax = std::min(tMax, t1);
+        if (tMin > tMax) return false;
+    }
+    entry = tMin;
+    return true;
+}
+
+static uint32_t pcgHash(uint32_t v) {
+    uint32_t state = v * 747796405u + 2891336453u;
+    uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// [0, 1)
+float RayTracer::Rng::next() {
+    state = pcgHash(state);
+    return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+// 레이와 삼각형 교차 체크
+bool RayTracer::intersectRayTriangle(const Ray& ray, const QVector3D& v0, const QVector3D& v1, const QVector3D& v2, float& t, QVector3D& normal) {
+    const float EPSILON = 1e-6;
+    QVector3D edge1 = v1 - v0;
+    QVector3D edge2 = v2 - v0;
+    QVector3D h = QVector3D::crossProduct(ray.direction, edge2);
+    float a = QVector3D::dotProduct(edge1, h);
+    if (fabs(a) < EPSILON) return false;
+
+    float f = 1.0 / a;
+    QVector3D s = ray.origin - v0;
+    float u = f * QVector3D::dotProduct(s, h);
+    if (u < 0.0 || u > 1.0) return false;
+
+    QVector3D q = QVector3D::crossProduct(s, edge1);
+    float v = f * QVector3D::dotProduct(ray.direction, q);
+    if (v < 0.0 || u + v > 1.0) return false;
+
+    t = f * QVector3D::dotProduct(edge2, q);
+    if (t > EPSILON) {
+        normal = QVector3D::crossProduct(edge1, edge2).normalized();
+        return true;
+    }
+    return false;
+}
+
+// 장면 내 레이 교차 확인
+RayTracer::HitInfo RayTracer::traceRay(const Ray& ray) const {
+    float closestT = 1e6;
+    HitInfo result;
+
+    // (1) 모델 교차 검사: 레이를 인스턴스의 오브젝트 공간으로 옮겨서 검사
+    // 방향을 정규화하지 않으므로 t는 월드 공간 거리와 같음
+    const InstanceData* hitInstance = nullptr;
+    QVector3D hitNormal;
+    for (const InstanceData& instance : instanceData) {
+        Ray local{ instance.toObject.map(ray.origin), instance.toObject.mapVector(ray.direction) };
+        if (!intersectBounds(local, meshBoundsMin, meshBoundsMax, closestT)) continue;
+
+        if (pagedMesh) {
+            if (intersectPages(local, closestT, hitNormal)) hitInstance = &instance;
+            continue;
+        }
+        for (const auto& face : mesh.faces) {
+            const auto& v0 = mesh.vertices[face.v1];
+            const auto& v1 = mesh.vertices[face.v2];
+            const auto& v2 = mesh.vertices[face.v3];
+
+            QVector3D vert0(v0.x, v0.y, v0.z);
+            QVector3D vert1(v1.x, v1.y, v1.z);
+            QVector3D vert2(v2.x, v2.y, v2.z);
+
+            float t;
+            QVector3D normal;
+            if (intersectRayTriangle(local, vert0, vert1, vert2, t, normal)) {
+                if (t < closestT && !std::isnan(t)) {
+                    closestT = t;
+                    hitInstance = &instance;
+                    hitNormal = normal;
+                }
+            }
+        }
+    }
+    if (hitInstance) {
+        result.hit = true;
+        result.distance = closestT;
+        result.position = ray.origin + ray.direction * closestT;
+        result.normal = hitInstance->normalToWorld.mapVector(hitNormal).normalized();
+        result.objectId = hitInstance->objectId;
+        if (textured()) result.localPosition = hitInstance->toObject.map(result.position);
+    }
+
+    // (2) 바닥 y = -1 평면 검사
+    if (fabs(ray.direction.y()) > 1e-6f) {
+        float t = (-1.0f - ray.origin.y()) / ray.direction.y();
+        if (t > 0.0f && t < closestT) {
+            QVector3D hitPoint = ray.origin + t * ray.direction;
+            if (hitPoint.x() >= -10.0f && hitPoint.x() <= 10.0f &&
+                hitPoint.z() >= -10.0f && hitPoint.z() <= 10.0f) {
+                closestT = t;
+                result.hit = true;
+                result.distance = t;
+                result.position = hitPoint;
+                result.normal = QVector3D(0, 1, 0); // 바닥 normal
+                result.objectId = 0; // 바닥
+            }
+        }
+    }
+
+    return result;
+}
+
+
+// === 페이지 메쉬 ===
+
+void RayTracer::setPagedMesh(const PagedMesh* paged) {
+    pagedMesh = paged;
+    ++version;
+
+    pageTree.clear();
+    if (!pagedMesh || pagedMesh->pageCount() == 0) return;
+    pageTree.reserve(size_t(pagedMesh->pageCount()) * 2);
+    std::vector<int> pages(pagedMesh->pageCount());
+    for (size_t i = 0; i < pages.size(); ++i) pages[i] = int(i);
+    buildPageTree(pages, 0, int(pages.size()));
+}
+
+// light BVH와 같은 방식: 페이지 박스 중심의 가장 긴 축 중앙값으로 분할 (루트는 0)
+int RayTracer::buildPageTree(std::vector<int>& pages, int begin, int end) {
+    int nodeIndex = int(pageTree.size());
+    pageTree.push_back(PageNode());
+
+    const float inf = std::numeric_limits<float>::max();
+    PageNode node;
+    node.boundsMin = QVector3D(inf, inf, inf);
+    node.boundsMax = QVector3D(-inf, -inf, -inf);
+    QVector3D centerMin = node.boundsMin;
+    QVector3D centerMax = node.boundsMax;
+    auto center = [&](int p) {
+        const PagedMesh::PageInfo& info = pagedMesh->page(p);
+        return 0.5f * QVector3D(info.boundsMin.x + info.boundsMax.x, info.boundsMin.y + info.boundsMax.y,
+                                info.boundsMin.z + info.boundsMax.z);
+    };
+    for (int i = begin; i < end; ++i) {
+        const PagedMesh::PageInfo& info = pagedMesh->page(pages[i]);
+        QVector3D c = center(pages[i]);
+        node.boundsMin = QVector3D(std::min(node.boundsMin.x(), info.boundsMin.x), std::min(node.boundsMin.y(), info.boundsMin.y),
+                                   std::min(node.boundsMin.z(), info.boundsMin.z));
+        node.boundsMax = QVector3D(std::max(node.boundsMax.x(), info.boundsMax.x), std::max(node.boundsMax.y(), info.boundsMax.y),
+                                   std::max(node.boundsMax.z(), info.boundsMax.z));
+        centerMin = QVector3D(std::min(centerMin.x(), c.x()), std::min(centerMin.y(), c.y()), std::min(centerMin.z(), c.z()));
+        centerMax = QVector3D(std::max(centerMax.x(), c.x()), std::max(centerMax.y(), c.y()), std::max(centerMax.z(), c.z()));
+    }
+
+    if (end - begin == 1) {
+        node.page = pages[begin];
+    } else {
+        QVector3D extent = centerMax - centerMin;
+        int axis = extent.x() > extent.y() ? (extent.x() > extent.z() ? 0 : 2) : (extent.y() > extent.z() ? 1 : 2);
+        int mid = (begin + end) / 2;
+        std::nth_element(pages.begin() + begin, pages.begin() + mid, pages.begin() + end, [&](int a, int b) {
+            return center(a)[axis] < center(b)[axis];
+        });
+        node.left = buildPageTree(pages, begin, mid);
+        node.right = buildPageTree(pages, mid, end);
+    }
+
+    pageTree[nodeIndex] = node;
+    return nodeIndex;
+}
+
+// 페이지 BVH를 가까운 자식부터 내려감 (오브젝트 공간 레이)
+// 들어가는 t가 지금까지의 closestT보다 먼 노드는 건너뛰므로 앞쪽 페이지에서 맞으면 뒤쪽 페이지는 pin()하지 않음
+bool RayTracer::intersectPages(const Ray& local, float& closestT, QVector3D& normal) const {
+    struct Entry {
+        int node;
+        float t;
+    };
+    Entry stack[64]; // 중앙값 분할이라 깊이는 log2(페이지 수)
+    int top = 0;
+    bool found = false;
+
+    float t0, t1;
+    if (pageTree.empty() || !intersectBounds(local, pageTree[0].boundsMin, pageTree[0].boundsMax, closestT, t0)) return false;
+    stack[top++] = { 0, t0 };
+    while (top > 0) {
+        Entry entry = stack[--top];
+        if (entry.t >= closestT) continue;
+        const PageNode& node = pageTree[entry.node];
+
+        if (node.page >= 0) {
+            const PagedMesh::Page& page = pagedMesh->pin(node.page);
+            for (const PagedMesh::Triangle& tri : page.triangles) {
+                float t;
+                QVector3D n;
+                if (intersectRayTriangle(local, QVector3D(tri.v0.x, tri.v0.y, tri.v0.z), QVector3D(tri.v1.x, tri.v1.y, tri.v1.z),
+                                         QVector3D(tri.v2.x, tri.v2.y, tri.v2.z), t, n)) {
+                    if (t < closestT && !std::isnan(t)) {
+                        closestT = t;
+                        normal = n;
+                        found = true;
+                    }
+                }
+            }
+            continue;
+        }
+
+        const PageNode& left = pageTree[node.left];
+        const PageNode& right = pageTree[node.right];
+        bool hitLeft = intersectBounds(local, left.boundsMin, left.boundsMax, closestT, t0);
+        bool hitRight = intersectBounds(local, right.boundsMin, right.boundsMax, closestT, t1);
+        // 먼 쪽을 먼저 쌓아서 가까운 쪽이 먼저 나오게
+        if (hitLeft && hitRight) {
+            if (t0 <= t1) {
+                stack[top++] = { node.right, t1 };
+                stack[top++] = { node.left, t0 };
+            } else {
+                stack[top++] = { node.left, t0 };
+                stack[top++] = { node.right, t1 };
+            }
+        } else if (hitLeft) {
+            stack[top++] = { node.left, t0 };
+        } else if (hitRight) {
+            stack[top++] = { node.right, t1 };
+        }
+    }
+    return found;
+}
+
+// 섀도우 레이
+bool RayTracer::isInShadow(const QVector3D& point, const QVector3D& lightPos) const {
+    QVector3D dir = (lightPos - point).normalized();
+    Ray shadowRay{ point + dir * 0.01f, dir };
+    HitInfo hit = traceRay(shadowRay);
+    float distToLight = (lightPos - point).length();
+    return hit.hit && hit.distance < distToLight;
+}
+
+// === 광원 ===
+
+void RayTracer::setLights(const std::vector<Light>& lights) {
+    sceneLights = lights;
+    lightTree.clear();
+    ++version;
+    if (sceneLights.empty()) return;
+
+    lightTree.reserve(sceneLights.size() * 2);
+    std::vector<int> indices(sceneLights.size());
+    for (size_t i = 0; i < indices.size(); ++i) indices[i] = int(i);
+    buildLightTree(indices, 0, int(indices.size()));
+}
+
+static float luminance(const QVector3D& c) {
+    return 0.2126f * c.x() + 0.7152f * c.y() + 0.0722f * c.z();
+}
+
+// 가장 긴 축의 중앙값으로 분할, 반환값은 노드 인덱스 (루트는 0)
+int RayTracer::buildLightTree(std::vector<int>& indices, int begin, int end) {
+    int nodeIndex = int(lightTree.size());
+    lightTree.push_back(LightNode());
+
+    LightNode node;
+    node.boundsMin = node.boundsMax = sceneLights[indices[begin]].position;
+    for (int i = begin; i < end; ++i) {
+        const Light& light = sceneLights[indices[i]];
+        for (int axis = 0; axis < 3; ++axis) {
+            node.boundsMin[axis] = std::min(node.boundsMin[axis], light.position[axis]);
+            node.boundsMax[axis] = std::max(node.boundsMax[axis], light.position[axis]);
+        }
+        node.power += std::max(luminance(light.color), 1e-6f);
+    }
+
+    if (end - begin == 1) {
+        node.light = indices[begin];
+    } else {
+        QVector3D extent = node.boundsMax - node.boundsMin;
+        int axis = extent.x() > extent.y() ? (extent.x() > extent.z() ? 0 : 2) : (extent.y() > extent.z() ? 1 : 2);
+        int mid = (begin + end) / 2;
+        std::nth_element(indices.begin() + begin, indices.begin() + mid, indices.begin() + end, [&](int a, int b) {
+            return sceneLights[a].position[axis] < sceneLights[b].position[axis];
+        });
+        node.left = buildLightTree(indices, begin, mid);
+        node.right = buildLightTree(indices, mid, end);
+    }
+
+    lightTree[nodeIndex] = node;
+    return nodeIndex;
+}
+
+// 노드 전체 광량 / 거리² 추정, 법선 뒤쪽에만 있는 노드는 0
+float RayTracer::lightImportance(const LightNode& node, const QVector3D& point, const QVector3D& normal, bool oriented) const {
+    if (oriented) {
+        bool anyInFront = false;
+        for (int corner = 0; corner < 8 && !anyInFront; ++corner) {
+            QVector3D c((corner & 1) ? node.boundsMax.x() : node.boundsMin.x(),
+                        (corner & 2) ? node.boundsMax.y() : node.boundsMin.y(),
+                        (corner & 4) ? node.boundsMax.z() : node.boundsMin.z());
+            anyInFront = QVector3D::dotProduct(normal, c - point) > 0.0f;
+        }
+        if (!anyInFront) return 0.0f;
+    }
+
+    QVector3D center = 0.5f * (node.boundsMin + node.boundsMax);
+    float radius = 0.5f * (node.boundsMax - node.boundsMin).length();
+    float distSq = (center - point).lengthSquared();
+    return node.power / std::max(distSq, radius * radius + 1e-4f);
+}
+
+// 루트에서 중요도 비율로 자식을 골라 내려감, pdf는 선택 확률의 곱
+int RayTracer::sampleLightTree(const QVector3D& point, const QVector3D& normal, bool oriented, Rng& rng, float& pdf) const {
+    pdf = 1.0f;
+    int nodeIndex = 0;
+    while (lightTree[nodeIndex].light < 0) {
+        const LightNode& node = lightTree[nodeIndex];
+        float left = lightImportance(lightTree[node.left], point, normal, oriented);
+        float right = lightImportance(lightTree[node.right], point, normal, oriented);
+        if (left + right <= 0.0f) return -1;
+
+        float pLeft = left / (left + right);
+        if (rng.next() < pLeft) {
+            pdf *= pLeft;
+            nodeIndex = node.left;
+        } else {
+            pdf *= 1.0f - pLeft;
+            nodeIndex = node.right;
+        }
+    }
+    return lightTree[nodeIndex].light;
+}
+
+// 직접광: 광원별 (가시성 × 코사인 × 색)의 합 (GL처럼 더하기만 하고 resolve()에서 자름)
+// 바닥(objectId 0)은 기존처럼 법선 방향 없이 그림자 여부만 반영
+QVector3D RayTracer::directLight(const HitInfo& hit, Rng& rng) const {
+    const bool oriented = hit.objectId != 0;
+    const QVector3D normal = hit.normal.normalized();
+
+    auto contribution = [&](const Light& light) {
+        float cosine = 1.0f;
+        if (oriented) {
+            cosine = std::max(QVector3D::dotProduct(normal, (light.position - hit.position).normalized()), 0.0f);
+            if (cosine <= 0.0f) return QVector3D(0.0f, 0.0f, 0.0f);
+        }
+        if (shadows && isInShadow(hit.position, sampleLight(light.position, rng))) return QVector3D(0.0f, 0.0f, 0.0f);
+        return cosine * light.color;
+    };
+
+    QVector3D result(0.0f, 0.0f, 0.0f);
+    if (int(sceneLights.size()) <= exhaustiveLightLimit) {
+        for (const Light& light : sceneLights) result += contribution(light);
+        return result;
+    }
+
+    float pdf;
+    int index = sampleLightTree(hit.position, normal, oriented, rng, pdf);
+    if (index < 0) return result;
+    return contribution(sceneLights[index]) / pdf;
+}
+
+// 구형 광원 위의 한 점 (lightRadius가 0이면 중심 그대로)
+QVector3D RayTracer::sampleLight(const QVector3D& center, Rng& rng) const {
+    if (lightRadius <= 0.0f) return center;
+
+    float z = 1.0f - 2.0f * rng.next();
+    float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+    float phi = 2.0f * float(M_PI) * rng.next();
+    return center + lightRadius * QVector3D(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+QVector3D RayTracer::traceRecursive(const Ray& ray, int depth, Path& path) const {
+    if (depth > maxDepth) return QVector3D(0.1f, 0.1f, 0.1f); // 배경색
+
+    path.segments++;
+    return shade(ray, traceRay(ray), depth, path);
+}
+
+// 다음 반사를 따라갈지 결정: 따라가면 반사 가중치(생존 확률로 나눈 값), 끊으면 0
+// reflectance: 표면 반사율 (알베도 × 반사 가중치), throughput에 곱해짐
+float RayTracer::continuePath(Path& path, float weight, const QVector3D& reflectance) const {
+    QVector3D throughput = path.throughput * reflectance;
+    float survival = 1.0f;
+    if (russianRoulette) {
+        float level = std::max({ throughput.x(), throughput.y(), throughput.z() });
+        if (level < rouletteThreshold) {
+            survival = level / rouletteThreshold;
+            if (path.rng.next() >= survival) return 0.0f;
+        }
+    }
+    path.throughput = throughput / survival;
+    return weight / survival;
+}
+
+QVector3D RayTracer::shade(const Ray& ray, const HitInfo& hit, int depth, Path& path) const {
+    if (!hit.hit || std::isnan(hit.normal.x())) {
+        return QVector3D(0.2f, 0.2f, 0.2f);
+    }
+
+    // 바닥에 그림자만: 광원이 모두 가려지면 기본색의 0.2배
+    if (hit.objectId == 0) {
+        QVector3D direct;
+        if (!useLightmap() || !floorLightmap.lookup(hit.position, direct)) direct = directLight(hit, path.rng);
+        QVector3D floorColor(0.3f, 0.3f, 0.3f); // 기본 바닥색
+        return floorColor * (QVector3D(0.2f, 0.2f, 0.2f) + 0.8f * direct);
+    }
+
+    // 소일 경우
+    QVector3D color = directLight(hit, path.rng); // 흰색 재질
+    QVector3D surface(1.0f, 1.0f, 1.0f);
+    if (textured()) {
+        surface = albedo(hit);
+        color *= surface;
+    }
+
+    // 반사
+    if (!reflections) return color;
+    QVector3D reflectDir = ray.direction - 2.0f * QVector3D::dotProduct(ray.direction, hit.normal) * hit.normal;
+    reflectDir.normalize();
+
+    if (!std::isnan(reflectDir.x())) {
+        // 상한에 걸리는 반사는 레이를 쏘지 않으므로(배경색) 룰렛도 돌리지 않음
+        float weight = depth < maxDepth ? continuePath(path, 0.5f, surface * 0.5f) : 0.5f;
+        if (weight > 0.0f) {
+            Ray reflectRay;
+            reflectRay.origin = hit.position + hit.normal * 0.01f;
+            reflectRay.direction = reflectDir;
+            QVector3D reflectColor = traceRecursive(reflectRay, depth + 1, path);
+            color += weight * reflectColor;
+        }
+    }
+
+    return color;
+}
+
+void RayTracer::setTexture(const QImage& image) {
+    texture = image.isNull() ? QImage() : image.convertToFormat(QImage::Format_RGB32);
+    ++version;
+}
+
+// GL과 같은 좌표 (u, v) = ((x + 1) / 2, (z + 1) / 2), 반복 + 최근접 샘플
+// GL 텍스처는 상하 반전해서 올리므로 v = 0이 이미지 아래쪽
+QVector3D RayTracer::albedo(const HitInfo& hit) const {
+    float u = (hit.localPosition.x() + 1.0f) * 0.5f;
+    float v = (hit.localPosition.z() + 1.0f) * 0.5f;
+    u -= std::floor(u);
+    v -= std::floor(v);
+    int x = std::min(texture.width() - 1, int(u * texture.width()));
+    int y = std::min(texture.height() - 1, int((1.0f - v) * texture.height()));
+    QRgb texel = reinterpret_cast<const QRgb*>(texture.constScanLine(y))[x];
+    return QVector3D(qRed(texel), qGreen(texel), qBlue(texel)) * (1.0f / 255.0f);
+}
+
+// 전체 이미지 렌더링
+RayTracer::RenderStats RayTracer::render(QImage& image) const {
+    using Clock = std::chrono::steady_clock;
+    RenderStats stats;
+
+    // 프레임 임시 버퍼는 아레나에서 (FrameArena::endFrame()에서 해제)
+    GBuffer gbuffer;
+    gbuffer.allocate(FrameArena::local(), image.width(), image.height());
+
+    Lightmap::Stats lightmapStats = updateLightmap();
+    stats.lightmapMs = lightmapStats.bakeMs;
+    stats.lightmapTexels = lightmapStats.bakedTexels;
+
+    auto traceStart = Clock::now();
+    uint64_t segments = traceRegion(gbuffer, 0, 0, image.width(), image.height());
+    stats.traceMs = std::chrono::duration<double, std::milli>(Clock::now() - traceStart).count();
+    stats.averagePathLength = double(segments) / (double(image.width()) * image.height() * std::max(1, samplesPerPixel));
+
+    stats.denoiseMs = resolve(gbuffer, image);
+    return stats;
+}
+
+Lightmap::Stats RayTracer::updateLightmap() const {
+    if (!lightmap) return Lightmap::Stats();
+    return floorLightmap.update(*this, lightmapDensity, lightmapSamples);
+}
+
+// 하이브리드 렌더링: 1차 가시성은 GL이 래스터화한 G-buffer에서
+RayTracer::RenderStats RayTracer::render(const PrimarySurfaces& surfaces, QImage& image) const {
+    using Clock = std::chrono::steady_clock;
+    RenderStats stats;
+
+    GBuffer gbuffer;
+    gbuffer.allocate(FrameArena::local(), image.width(), image.height());
+    const int w = gbuffer.width;
+    std::atomic<uint64_t> segments{0};
+
+    Lightmap::Stats lightmapStats = updateLightmap();
+    stats.lightmapMs = lightmapStats.bakeMs;
+    stats.lightmapTexels = lightmapStats.bakedTexels;
+
+    auto traceStart = Clock::now();
+    ThreadPool::instance().parallelFor(gbuffer.height, [&](int row, int) {
+        uint64_t rowSegments = 0;
+        for (int col = 0; col < w; ++col) {
+            rowSegments += tracePixel(gbuffer, size_t(row) * w + col, col, row, w, gbuffer.height, nullptr, &surfaces);
+        }
+        segments.fetch_add(rowSegments, std::memory_order_relaxed);
+    });
+    stats.traceMs = std::chrono::duration<double, std::milli>(Clock::now() - traceStart).count();
+    stats.averagePathLength = double(segments.load()) / (double(w) * gbuffer.height * std::max(1, samplesPerPixel));
+
+    stats.denoiseMs = resolve(gbuffer, image);
+    return stats;
+}
+
+// G-buffer 픽셀 → traceRay()가 돌려줬을 히트
+// 바닥은 평면 위로 맞추고, 텍스처 좌표용 오브젝트 공간 위치는 objectId로 인스턴스를 찾아 계산
+RayTracer::HitInfo RayTracer::surfaceHit(const PrimarySurfaces& surfaces, int x, int y) const {
+    HitInfo hit;
+    const size_t i = (size_t(surfaces.height - 1 - y) * surfaces.width + x) * 4;
+    const float* p = surfaces.position + i;
+    const int objectId = int(std::lround(p[3]));
+    if (objectId < 0) return hit;
+
+    hit.hit = true;
+    hit.objectId = objectId;
+    hit.position = QVector3D(p[0], p[1], p[2]);
+    const float* n = surfaces.normal + i;
+    hit.normal = QVector3D(n[0], n[1], n[2]).normalized();
+    if (objectId == 0) {
+        hit.position.setY(-1.0f); // 보간 오차 제거 (바닥 평면 위로)
+    } else if (textured()) {
+        for (const InstanceData& instance : instanceData) {
+            if (instance.objectId != objectId) continue;
+            hit.localPosition = instance.toObject.map(hit.position);
+            break;
+        }
+    }
+    hit.distance = (hit.position - cameraPos).length();
+    return hit;
+}
+
+uint64_t RayTracer::traceRegion(GBuffer& target, int x0, int y0, int imageWidth, int imageHeight,
+                                uint8_t* pathSegments) const {
+    const int w = target.width;
+    updateLightmap();
+    std::atomic<uint64_t> segments{0};
+
+    // 행 단위로 워커 스레드에 분배
+    ThreadPool::instance().parallelFor(target.height, [&](int row, int) {
+        uint64_t rowSegments = 0;
+        for (int col = 0; col < w; ++col) {
+            rowSegments += tracePixel(target, size_t(row) * w + col, x0 + col, y0 + row, imageWidth, imageHeight,
+                                      pathSegments);
+        }
+        segments.fetch_add(rowSegments, std::memory_order_relaxed);
+    });
+    return segments.load();
+}
+
+uint64_t RayTracer::tracePixels(GBuffer& target, const int* pixels, int count, uint8_t* pathSegments) const {
+    const int w = target.width;
+    updateLightmap();
+    std::atomic<uint64_t> segments{0};
+
+    // 흩어진 픽셀이라 작은 묶음으로 분배
+    const int batch = 256;
+    ThreadPool::instance().parallelFor((count + batch - 1) / batch, [&](int chunk, int) {
+        uint64_t chunkSegments = 0;
+        for (int k = chunk * batch; k < std::min(count, (chunk + 1) * batch); ++k) {
+            const int pixel = pixels[k];
+            chunkSegments += tracePixel(target, size_t(pixel), pixel % w, pixel / w, w, target.height, pathSegments);
+        }
+        segments.fetch_add(chunkSegments, std::memory_order_relaxed);
+    });
+    return segments.load();
+}
+
+uint64_t RayTracer::tracePixel(GBuffer& target, size_t i, int x, int y, int imageWidth, int imageHeight,
+                               uint8_t* pathSegments, const PrimarySurfaces* surfaces) const {
+    const int spp = std::max(1, samplesPerPixel);
+    const HitInfo primary = surfaces ? surfaceHit(*surfaces, x, y) : HitInfo();
+    const size_t pixel = size_t(y) * imageWidth + x; // 난수 시드 (전체 이미지 기준)
+    QVector3D sum(0.0f, 0.0f, 0.0f);
+    float luminanceSquares = 0.0f; // 디노이저용 샘플 분산
+    uint64_t segments = 0;
+    int longest = 0;
+
+    for (int s = 0; s < spp; ++s) {
+        Path path(pcgHash(uint32_t(pixel) * uint32_t(spp) + uint32_t(s)));
+
+        // 첫 샘플은 픽셀 위치 그대로, 나머지는 픽셀 안에서 지터
+        float px = float(x), py = float(y);
+        if (s > 0) {
+            px += path.rng.next() - 0.5f;
+            py += path.rng.next() - 0.5f;
+        }
+        float ndcX = (2.0f * px / imageWidth) - 1.0f;
+        float ndcY = 1.0f - (2.0f * py / imageHeight);
+        QVector3D rayDir(ndcX, ndcY, -1.0f);
+        rayDir.normalize();
+        Ray ray{cameraPos, rayDir};
+
+        // 하이브리드: 히트점을 향하는 레이로 바꿔서 반사 방향도 같게 (미스는 픽셀 레이 그대로)
+        HitInfo hit;
+        if (surfaces) {
+            hit = primary;
+            if (hit.hit) ray.direction = (hit.position - cameraPos).normalized();
+        } else {
+            hit = traceRay(ray);
+        }
+        path.segments = 1;
+        if (s == 0) {
+            // 디노이저 가이드 버퍼
+            bool valid = hit.hit && !std::isnan(hit.normal.x());
+            QVector3D n = valid ? hit.normal.normalized() : QVector3D(0.0f, 0.0f, 0.0f);
+            target.nx[i] = n.x();
+            target.ny[i] = n.y();
+            target.nz[i] = n.z();
+            target.depth[i] = valid ? hit.distance : 1e6f;
+            target.objectId[i] = valid ? hit.objectId : -1;
+        }
+        const QVector3D sample = shade(ray, hit, 0, path);
+        const float luminance = 0.2126f * sample.x() + 0.7152f * sample.y() + 0.0722f * sample.z();
+        sum += sample;
+        luminanceSquares += luminance * luminance;
+        segments += uint64_t(path.segments);
+        longest = std::max(longest, path.segments);
+    }
+
+    sum /= float(spp);
+    target.r[i] = sum.x();
+    target.g[i] = sum.y();
+    target.b[i] = sum.z();
+    // 평균의 분산 = 표본 분산 / spp (1 spp는 알 수 없어서 -1)
+    const float mean = 0.2126f * sum.x() + 0.7152f * sum.y() + 0.0722f * sum.z();
+    target.variance[i] = spp > 1 ? std::max(0.0f, luminanceSquares - float(spp) * mean * mean) / float((spp - 1) * spp) : -1.0f;
+    if (pathSegments) pathSegments[i] = uint8_t(std::min(longest, 255));
+    return segments;
+}
+
+bool RayTracer::stochastic() const {
+    return samplesPerPixel > 1 || (shadows && lightRadius > 0.0f) || int(sceneLights.size()) > exhaustiveLightLimit;
+}
+
+double RayTracer::resolve(GBuffer& gbuffer, QImage& image) const {
+    using Clock = std::chrono::steady_clock;
+    const int w = gbuffer.width;
+    const int h = gbuffer.height;
+
+    // (1) 디노이즈
+    double denoiseMs = 0.0;
+    if (denoise && stochastic()) {
+        auto denoiseStart = Clock::now();
+        denoiser.apply(gbuffer);
+        denoiseMs = std::chrono::duration<double, std::milli>(Clock::now() - denoiseStart).count();
+    }
+
+    // (2) 이미지 기록 (bits()는 메인 스레드에서 한 번만 호출해 detach)
+    uchar* bits = image.bits();
+    const qsizetype bytesPerLine = image.bytesPerLine();
+    ThreadPool::instance().parallelFor(h, [&](int y, int) {
+        QRgb* line = reinterpret_cast<QRgb*>(bits + y * bytesPerLine);
+        for (int x = 0; x < w; ++x) {
+            const size_t i = size_t(y) * w + x;
+            int r = std::min(255, int(gbuffer.r[i] * 255));
+            int g = std::min(255, int(gbuffer.g[i] * 255));
+            int b = std::min(255, int(gbuffer.b[i] * 255));
+            line[x] = qRgb(r, g, b);
+        }
+    });
+
+    return denoiseMs;
+}
@@ -0,0 +1,227 @@
+#ifndef RAYTRACER_H
+#define RAYTRACER_H
+
+#include <QImage>
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <cstdint>
+#include <vector>
+
+#include "objloader.h"
+#include "denoiser.h"
+#include "lightmap.h"
+#include "pagedmesh.h"
+
+// CPU 레이 트레이서
+// 위젯 상태와 분리되어 있어 워커 스레드에서 동시에 traceRecursive()를 호출해도 안전
+class RayTracer {
+public:
+    struct Ray {
+        QVector3D origin;
+        QVector3D direction;
+    };
+
+    struct HitInfo {
+        float distance;
+        QVector3D position;
+        QVector3D normal;
+        bool hit = false;
+        int objectId = -1;
+        QVector3D localPosition; // 오브젝트 공간 히트 위치 (텍스처 좌표용)
+    };
+
+    // 픽셀/샘플별 결정적 난수 (PCG 해시) - 같은 설정이면 항상 같은 이미지
+    struct Rng {
+        uint32_t state;
+        explicit Rng(uint32_t seed) : state(seed) {}
+        float next();
+    };
+
+    // 경로 하나의 상태: 반사를 따라가며 누적 가중치(throughput)와 추적한 레이 수를 갱신
+    struct Path {
+        Rng rng;
+        QVector3D throughput = QVector3D(1.0f, 1.0f, 1.0f);
+        int segments = 0; // 1차 레이 + 반사 레이
+        explicit Path(uint32_t seed) : rng(seed) {}
+    };
+
+    // 점광원 (GL 광원과 같은 위치/색)
+    struct Light {
+        QVector3D position;
+        QVector3D color;
+    };
+
+    // 메쉬 인스턴스 (GL 쪽 소 모델 행렬과 같은 변환)
+    struct Instance {
+        QMatrix4x4 transform; // 오브젝트 → 월드
+        int objectId;         // G-buffer/디노이저 구분용 (0은 바닥)
+    };
+
+    struct RenderStats {
+        double traceMs = 0.0;
+        double denoiseMs = 0.0;
+        double averagePathLength = 0.0; // 샘플당 추적한 레이 수 (1차 + 반사, 섀도우 레이 제외)
+        double tracedFraction = 1.0;    // 다시 추적한 픽셀 비율 (TemporalCache)
+        double lightmapMs = 0.0;        // 바닥 라이트맵을 다시 구운 시간
+        int lightmapTexels = 0;
+    };
+
+    // 래스터화한 1차 가시성 (하이브리드 렌더링, GL G-buffer를 읽어온 것)
+    // 픽셀마다 float 4개, 행은 GL 순서 (아래 행부터)
+    struct PrimarySurfaces {
+        int width = 0;
+        int height = 0;
+        const float* position = nullptr; // 월드 위치 xyz, w: objectId (미스는 -1)
+        const float* normal = nullptr;   // 월드 면 법선 xyz
+    };
+
+    explicit RayTracer(const ObjLoader& mesh);
+
+    int maxDepth = 16; // 반사 깊이 상한: 경로는 러시안 룰렛이 끊고, 이 값은 안전장치로만
+
+    // 러시안 룰렛: 경로 throughput(반사마다 알베도 × 0.5를 곱함)의 최대 성분이 임계값 아래로 떨어지면
+    // throughput / 임계값 확률로만 다음 반사를 추적하고 살아남은 경로는 그만큼 가중치를 키움
+    // (기댓값은 끄고 그린 이미지와 같음)
+    bool russianRoulette = true;
+    float rouletteThreshold = 0.25f;
+    QVector3D cameraPos = QVector3D(0.0f, 3.0f, 10.0f);
+
+    // 확률적 요소: 픽셀당 샘플 수, 구형 광원 반지름 (0이면 하드 섀도우)
+    int samplesPerPixel = 1;
+    float lightRadius = 0.0f;
+
+    // 광원 목록: 켜진 광원만 전달
+    // exhaustiveLightLimit개 이하면 전부 계산하고, 그보다 많으면 light BVH로 하나만 골라
+    // 섀도우 레이 1개 + O(log N) 탐색으로 처리 (광원 수와 무관한 비용)
+    // 광원 색은 절대값: 보이는 광원의 색을 더하고 resolve()에서 [0, 1]로 자름 (GL과 같음)
+    void setLights(const std::vector<Light>& lights);
+    const std::vector<Light>& lights() const { return sceneLights; }
+    int exhaustiveLightLimit = 4;
+
+    // 인스턴스 목록: 기본값은 변환 없는 메쉬 하나 (objectId 1)
+    // 메쉬가 바뀌면 다시 호출해야 함 (오브젝트 공간 바운딩 박스 캐시)
+    void setInstances(const std::vector<Instance>& instances);
+    const std::vector<Instance>& instances() const { return sceneInstances; }
+    const ObjLoader& model() const { return mesh; }
+    void worldBounds(const QMatrix4x4& transform, QVector3D& boundsMin, QVector3D& boundsMax) const;
+
+    // 페이지 메쉬가 있으면 ObjLoader 대신 사용 (페이지 바운딩 박스 BVH를 가까운 순서로 내려가며
+    // 필요한 페이지만 읽고, 찾은 히트보다 먼 박스는 건너뜀). open() 뒤에 넘기고, 바꾼 뒤에는 setInstances()를 다시 호출
+    void setPagedMesh(const PagedMesh* paged);
+
+    // 광원/텍스처/페이지 메쉬가 바뀔 때마다 증가 (프레임 간 캐시 무효화용)
+    unsigned sceneVersion() const { return version; }
+
+    // 기능 스위치
+    bool shadows = true;
+    bool reflections = true;
+
+    // 소 텍스처 (GL과 같은 오브젝트 공간 x/z 기반 좌표), null 이미지면 끔
+    void setTexture(const QImage& image);
+    bool textured() const { return !texture.isNull(); }
+
+    // 바닥 라이트맵: 바닥 히트의 직접광을 섀도우 레이 대신 텍스처 공간 캐시에서 조회 (Lightmap 참고)
+    // 하드 섀도우는 그림자가 질 수 있는 영역 안에서만 섀도우 레이를 쏘고, 확률적 직접광은 텍셀마다 lightmapSamples개 평균
+    bool lightmap = true;
+    float lightmapDensity = 8.0f; // 월드 단위당 텍셀 수
+    int lightmapSamples = 8;
+    // 추적 진입점(render/traceRegion/tracePixels)이 메인 스레드에서 먼저 호출 (바뀐 것이 없으면 바로 반환)
+    Lightmap::Stats updateLightmap() const;
+    void invalidateLightmap() { floorLightmap.invalidate(); } // 메쉬를 바꿨을 때
+    float lightmapTexelSize() const { return floorLightmap.ready() ? floorLightmap.texelSize() : 0.0f; }
+
+    // 저 spp 노이즈 제거. 확률적 샘플링이 있을 때만 적용 (1 spp 점광원 하드 섀도우는 노이즈가 없어 그대로)
+    bool denoise = true;
+    Denoiser denoiser;
+    // 픽셀 지터(spp > 1), 구형 광원 그림자, light BVH 샘플링 중 하나라도 쓰는지
+    // 러시안 룰렛은 제외: 세 번째 반사부터만 끊겨서 바뀌는 픽셀이 드물고, 디노이즈가 오차를 오히려 키움
+    bool stochastic() const;
+
+    // 프레임 렌더링: 프레임 아레나의 G-buffer에 추적 → 디노이즈 → image에 기록
+    // image는 호출자가 소유 (프레임마다 새로 만들지 않도록)
+    RenderStats render(QImage& image) const;
+
+    // 이미지(imageWidth x imageHeight)의 (x0, y0)부터 target 크기만큼만 추적 (디노이즈 전)
+    // 픽셀 난수는 전체 이미지 좌표 기준이라 타일로 나눠 그려도 결과가 같음
+    // 반환값은 추적한 경로 세그먼트 수 (평균 경로 길이 계산용)
+    // pathSegments가 있으면 픽셀마다 가장 긴 샘플 경로의 세그먼트 수를 기록 (target 인덱스 기준)
+    uint64_t traceRegion(GBuffer& target, int x0, int y0, int imageWidth, int imageHeight,
+                         uint8_t* pathSegments = nullptr) const;
+    // 이미지 크기의 target에서 pixels(y * width + x)만 추적
+    uint64_t tracePixels(GBuffer& target, const int* pixels, int count, uint8_t* pathSegments = nullptr) const;
+
+    // 하이브리드: 1차 레이 대신 surfaces의 히트에서 시작해 섀도우/반사 레이만 추적 → 디노이즈 → image
+    // image와 surfaces 크기가 같아야 함. 1 spp에서는 render()와 같은 이미지
+    // (실루엣에서 래스터화/교차 판정이 갈리는 픽셀 제외). spp > 1이면 1차 히트는 지터 없이 공유
+    RenderStats render(const PrimarySurfaces& surfaces, QImage& image) const;
+    // 디노이즈 후 image에 기록 (image와 gbuffer 크기가 같아야 함)
+    double resolve(GBuffer& gbuffer, QImage& image) const;
+
+    static bool intersectBounds(const Ray& ray, const QVector3D& boundsMin, const QVector3D& boundsMax, float maxT);
+    static bool intersectBounds(const Ray& ray, const QVector3D& boundsMin, const QVector3D& boundsMax, float maxT, float& entry);
+    static bool intersectRayTriangle(const Ray& ray, const QVector3D& v0, const QVector3D& v1, const QVector3D& v2, float& t, QVector3D& normal);
+    HitInfo traceRay(const Ray& ray) const;
+    bool isInShadow(const QVector3D& point, const QVector3D& lightPos) const;
+    QVector3D traceRecursive(const Ray& ray, int depth, Path& path) const;
+    QVector3D shade(const Ray& ray, const HitInfo& hit, int depth, Path& path) const;
+    float continuePath(Path& path, float weight, const QVector3D& reflectance) const;
+    QVector3D sampleLight(const QVector3D& center, Rng& rng) const;
+    QVector3D directLight(const HitInfo& hit, Rng& rng) const;
+
+private:
+    // light BVH 노드 (leaf는 light >= 0)
+    struct LightNode {
+        QVector3D boundsMin;
+        QVector3D boundsMax;
+        float power = 0.0f;
+        int left = -1;
+        int right = -1;
+        int light = -1;
+    };
+
+    // 페이지 바운딩 박스 BVH 노드 (leaf는 page >= 0)
+    struct PageNode {
+        QVector3D boundsMin;
+        QVector3D boundsMax;
+        int left = -1;
+        int right = -1;
+        int page = -1;
+    };
+
+    // 인스턴스별 레이 변환 캐시
+    struct InstanceData {
+        QMatrix4x4 toObject;      // 월드 → 오브젝트
+        QMatrix4x4 normalToWorld; // toObject의 전치 (법선 변환)
+        int objectId;
+    };
+
+    const ObjLoader& mesh;
+    const PagedMesh* pagedMesh = nullptr;
+    std::vector<PageNode> pageTree;
+
+    std::vector<Instance> sceneInstances;
+    std::vector<InstanceData> instanceData;
+    QVector3D meshBoundsMin;
+    QVector3D meshBoundsMax;
+
+    std::vector<Light> sceneLights;
+    std::vector<LightNode> lightTree;
+    QImage texture; // Format_RGB32
+    unsigned version = 0;
+    mutable Lightmap floorLightmap; // 추적 중에는 읽기만
+
+    bool useLightmap() const { return lightmap && floorLightmap.ready(); }
+
+    QVector3D albedo(const HitInfo& hit) const;
+    uint64_t tracePixel(GBuffer& target, size_t i, int x, int y, int imageWidth, int imageHeight,
+                        uint8_t* pathSegments, const PrimarySurfaces* surfaces = nullptr) const;
+    HitInfo surfaceHit(const PrimarySurfaces& surfaces, int x, int y) const;
+
+    int buildLightTree(std::vector<int>& indices, int begin, int end);
+    float lightImportance(const LightNode& node, const QVector3D& point, const QVector3D& normal, bool oriented) const;
+    int buildPageTree(std::vector<int>& pages, int begin, int end);
+    bool intersectPages(const Ray& local, float& closestT, QVector3D& normal) const;
+    int sampleLightTree(const QVector3D& point, const QVector3D& normal, bool oriented, Rng& rng, float& pdf) const;
+};
+
+#endif // RAYTRACER_H
@@ -0,0 +1,339 @@
+#include "regression.h"
+#include "openglwindow.h"
+#include "framearena.h"
+
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <iostream>
+#include <map>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 합성 고해상도 메쉬: 반지름 1 UV 구 (면 수 = 2 * rings * segments)
+void writeSphereObj(const QString& path, int rings, int segments) {
+    std::ofstream out(path.toStdString());
+    for (int i = 0; i <= rings; ++i) {
+        float theta = float(M_PI) * i / rings;
+        for (int j = 0; j < segments; ++j) {
+            float phi = 2.0f * float(M_PI) * j / segments;
+            out << "v " << std::sin(theta) * std::cos(phi) << " " << std::cos(theta) << " "
+                << std::sin(theta) * std::sin(phi) << "\n";
+        }
+    }
+    for (int i = 0; i < rings; ++i) {
+        for (int j = 0; j < segments; ++j) {
+            int a = i * segments + j + 1;
+            int b = i * segments + (j + 1) % segments + 1;
+            int c = a + segments;
+            int d = b + segments;
+            out << "f " << a << " " << c << " " << b << "\n";
+            out << "f " << b << " " << c << " " << d << "\n";
+        }
+    }
+}
+
+// 여러 번 실행해서 가장 빠른 시간 (ms)
+double bestOf(int repeats, const std::function<void()>& run) {
+    double best = 1e30;
+    for (int i = 0; i < std::max(1, repeats); ++i) {
+        auto start = Clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+std::map<QString, double> readTimings(const QString& path) {
+    std::map<QString, double> timings;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return timings;
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QStringList fields = in.readLine().split(' ', Qt::SkipEmptyParts);
+        if (fields.size() == 2) timings[fields[0]] = fields[1].toDouble();
+    }
+    return timings;
+}
+
+void writeTimings(const QString& path, const std::map<QString, double>& timings) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+        std::cerr << "Failed to write " << path.toStdString() << std::endl;
+        return;
+    }
+    QTextStream out(&file);
+    for (const auto& entry : timings) out << entry.first << " " << entry.second << "\n";
+}
+
+// 채널 차이가 허용치를 넘는 픽셀 비율 (%), 크기가 다르면 100
+double differentPixelsPercent(const QImage& a, const QImage& b, int maxChannelDifference) {
+    if (a.size() != b.size()) return 100.0;
+    QImage ia = a.convertToFormat(QImage::Format_RGB32);
+    QImage ib = b.convertToFormat(QImage::Format_RGB32);
+
+    long long different = 0;
+    for (int y = 0; y < ia.height(); ++y) {
+        const QRgb* la = reinterpret_cast<const QRgb*>(ia.constScanLine(y));
+        const QRgb* lb = reinterpret_cast<const QRgb*>(ib.constScanLine(y));
+        for (int x = 0; x < ia.width(); ++x) {
+            int d = std::max({ std::abs(qRed(la[x]) - qRed(lb[x])),
+                               std::abs(qGreen(la[x]) - qGreen(lb[x])),
+                               std::abs(qBlue(la[x]) - qBlue(lb[x])) });
+            if (d > maxChannelDifference) different++;
+        }
+    }
+    return 100.0 * different / (double(ia.width()) * ia.height());
+}
+
+// 채널별 RMSE (0~255), 크기가 다르면 최대값
+double rootMeanSquareError(const QImage& a, const QImage& b) {
+    if (a.size() != b.size()) return 255.0;
+    QImage ia = a.convertToFormat(QImage::Format_RGB32);
+    QImage ib = b.convertToFormat(QImage::Format_RGB32);
+
+    double sum = 0.0;
+    for (int y = 0; y < ia.height(); ++y) {
+        const QRgb* la = reinterpret_cast<const QRgb*>(ia.constScanLine(y));
+        const QRgb* lb = reinterpret_cast<const QRgb*>(ib.constScanLine(y));
+        for (int x = 0; x < ia.width(); ++x) {
+            const double dr = qRed(la[x]) - qRed(lb[x]);
+            const double dg = qGreen(la[x]) - qGreen(lb[x]);
+            const double db = qBlue(la[x]) - qBlue(lb[x]);
+            sum += dr * dr + dg * dg + db * db;
+        }
+    }
+    return std::sqrt(sum / (3.0 * ia.width() * ia.height()));
+}
+
+class Harness {
+public:
+    explicit Harness(const RegressionOptions& options)
+        : options(options),
+          localDir(options.localDir.isEmpty() ? options.baselineDir : options.localDir),
+          timingPath(QDir(localDir).filePath("timings-" + QSysInfo::machineHostName() + ".txt")),
+          baseline(readTimings(timingPath))
+    {
+        QDir().mkpath(options.baselineDir);
+        QDir().mkpath(localDir);
+    }
+
+    // 시간 비교 (+ 이미지가 있으면 golden 비교)
+    // committed: 저장소(baselineDir)에 있는 golden (없으면 --update 없이는 실패), 아니면 localDir
+    void check(const QString& scene, double ms, const QImage& image = QImage(), bool committed = false) {
+        QString status = "PASS";
+        QString detail;
+
+        auto known = baseline.find(scene);
+        if (known == baseline.end() || options.update) {
+            status = "NEW";
+            detail = QString("%1 ms").arg(ms, 0, 'f', 1);
+            measured[scene] = ms;
+        } else {
+            double slowdown = 100.0 * (ms - known->second) / known->second;
+            detail = QString("%1 ms (baseline %2 ms, %3%4%)").arg(ms, 0, 'f', 1).arg(known->second, 0, 'f', 1)
+                         .arg(slowdown >= 0 ? "+" : "").arg(slowdown, 0, 'f', 1);
+            measured[scene] = known->second; // 기준은 --update로만 갱신
+            if (slowdown > options.maxSlowdownPercent) status = "FAIL";
+        }
+
+        if (!image.isNull()) {
+            QString goldenPath = QDir(committed ? options.baselineDir : localDir).filePath(scene + ".png");
+            QImage golden(goldenPath);
+            if (golden.isNull() && (committed || options.strict) && !options.update) {
+                detail += ", golden " + goldenPath + " missing (record with --update or the regression-update target)";
+                status = "FAIL";
+            } else if (golden.isNull() || options.update) {
+                image.save(goldenPath);
+                detail += ", golden written";
+                if (status == "PASS") status = "NEW";
+            } else {
+                double diff = differentPixelsPercent(image, golden, options.maxChannelDifference);
+                detail += QString(", %1% pixels differ").arg(diff, 0, 'f', 3);
+                if (diff > options.maxDifferentPixelsPercent) status = "FAIL";
+            }
+        }
+
+        report(scene, status, detail);
+    }
+
+    // 같은 장면을 다른 경로로 그린 두 이미지 비교 (기준 파일 없이), note는 결과 줄 끝에 덧붙임
+    void compare(const QString& scene, const QImage& image, const QImage& reference, double maxPercent,
+                 const QString& note = QString()) {
+        double diff = differentPixelsPercent(image, reference, options.maxChannelDifference);
+        report(scene, diff > maxPercent ? "FAIL" : "PASS", QString("%1% pixels differ").arg(diff, 0, 'f', 3) + note);
+    }
+
+    // 기준 이미지에 대한 오차가 비교 대상(디노이즈 전)보다 작아야 통과
+    void improves(const QString& scene, double error, double baselineError, const QString& note = QString()) {
+        report(scene, error < baselineError ? "PASS" : "FAIL",
+               QString("RMSE %1 (without denoise %2)").arg(error, 0, 'f', 2).arg(baselineError, 0, 'f', 2) + note);
+    }
+
+    void skip(const QString& scene, const QString& reason) {
+        report(scene, "SKIP", reason);
+    }
+
+    int finish() {
+        writeTimings(timingPath, measured);
+        std::cout << (failures ? "Regression FAILED: " : "Regression passed: ") << failures << " failure(s)" << std::endl;
+        return failures ? 1 : 0;
+    }
+
+private:
+    void report(const QString& scene, const QString& status, const QString& detail) {
+        if (status == "FAIL") failures++;
+        std::cout << "[" << status.toStdString() << "] " << scene.toStdString() << "  " << detail.toStdString() << std::endl;
+    }
+
+    const RegressionOptions& options;
+    QString localDir;
+    QString timingPath;
+    std::map<QString, double> baseline;
+    std::map<QString, double> measured;
+    int failures = 0;
+};
+
+}
+
+int runRegression(const RegressionOptions& options) {
+    Harness harness(options);
+
+    QTemporaryDir tempDir;
+    QString spherePath = tempDir.filePath("sphere-8k.obj");
+    writeSphereObj(spherePath, 64, 64); // 8192 삼각형
+
+    // 소 모델은 저장소에 없어서 golden도 localDir에 기록, 합성 구의 레이 트레이싱 golden은 저장소에 있음
+    struct Mesh { QString name; QString path; bool committedGolden; };
+    std::vector<Mesh> meshes;
+    if (!options.cowPath.isEmpty()) meshes.push_back({ "cow", options.cowPath, false });
+    meshes.push_back({ "sphere-8k", spherePath, true });
+
+    for (const Mesh& mesh : meshes) {
+        // (1) 로딩
+        double loadMs = bestOf(options.repeats, [&] {
+            ObjLoader loader;
+            loader.load(mesh.path.toStdString());
+        });
+        harness.check("load-" + mesh.name, loadMs);
+
+        OpenGLWindow window;
+        window.loadModel(mesh.path.toStdString());
+
+        // (2) 레이 트레이싱: 위젯과 같은 트레이서/광원, GL 없이 CPU만
+        QImage traced(options.traceWidth, options.traceHeight, QImage::Format_RGB32);
+        double traceMs = bestOf(options.repeats, [&] {
+            window.tracer().render(traced);
+            FrameArena::endFrame();
+        });
+        harness.check("raytrace-" + mesh.name, traceMs, traced, mesh.committedGolden);
+
+        // (3) 래스터: 오프스크린 프레임버퍼로 그려서 읽어옴
+        window.setRayTracing(false);
+        window.resize(options.rasterWidth, options.rasterHeight);
+        window.show();
+
+        const std::pair<const char*, void (OpenGLWindow::*)()> modes[] = {
+            { "flat", &OpenGLWindow::setFlatShading },
+            { "gouraud", &OpenGLWindow::setGouraudShading },
+        };
+        for (const auto& mode : modes) {
+            QString scene = QString::fromLatin1(mode.first) + "-" + mesh.name;
+            (window.*mode.second)();
+
+            QImage frame;
+            double rasterMs = bestOf(options.repeats, [&] { frame = window.grabFramebuffer(); });
+            if (frame.isNull()) {
+                harness.skip(scene, "no OpenGL context (run under xvfb-run for raster coverage)");
+            } else {
+                harness.check(scene, rasterMs, frame);
+            }
+        }
+
+        // (4) 하이브리드: 트레이서 크기로 그려서 전체 추적 이미지와 비교
+        //     디노이즈가 차이를 번지게 하지 않도록 둘 다 디노이즈 없이.
+        //     실루엣에서 래스터화/교차 판정이 갈리는 픽셀만큼은 허용
+        window.setRayTracing(true);
+        window.setHybrid(true);
+        window.resize(options.traceWidth, options.traceHeight);
+        QString hybridScene = "hybrid-" + mesh.name;
+        QImage hybrid;
+        double hybridMs = bestOf(options.repeats, [&] { hybrid = window.grabFramebuffer(); });
+        if (hybrid.isNull()) {
+            harness.skip(hybridScene, "no OpenGL context (run under xvfb-run for raster coverage)");
+        } else {
+            harness.check(hybridScene, hybridMs, hybrid);
+
+            window.setDenoise(false);
+            QImage rawTraced(options.traceWidth, options.traceHeight, QImage::Format_RGB32);
+            double rawTraceMs = bestOf(options.repeats, [&] {
+                window.tracer().render(rawTraced);
+                FrameArena::endFrame();
+            });
+            QImage rawHybrid;
+            double rawHybridMs = bestOf(options.repeats, [&] { rawHybrid = window.grabFramebuffer(); });
+            window.setDenoise(true);
+
+            // 하이브리드 프레임(래스터 + 읽기 + 추적 + 블릿) vs 전체 추적
+            harness.compare(hybridScene + "-vs-raytrace", rawHybrid, rawTraced, 1.0,
+                            QString(", hybrid frame %1 ms vs full trace %2 ms (x%3)")
+                                .arg(rawHybridMs, 0, 'f', 1).arg(rawTraceMs, 0, 'f', 1)
+                                .arg(rawTraceMs / std::max(rawHybridMs, 1e-3), 0, 'f', 2));
+        }
+    }
+
+    // (5) 디노이저 품질: 소프트 섀도우를 1/4 spp로 그리고 디노이즈한 이미지를 referenceSamples spp 기준과 비교
+    //     그림자가 화면을 많이 차지하도록 카메라를 당기고 바닥 라이트맵은 끔 (바닥 그림자도 픽셀마다 샘플링)
+    {
+        QString lowPolyPath = tempDir.filePath("sphere-2k.obj");
+        writeSphereObj(lowPolyPath, 24, 48); // 2304 삼각형 (기준 이미지 비용 때문에)
+        ObjLoader loader;
+        loader.load(lowPolyPath.toStdString());
+        RayTracer tracer(loader);
+        QMatrix4x4 left, right;
+        left.translate(-1.3f, 0.0f, -1.0f);
+        right.translate(1.3f, 0.0f, -1.0f);
+        tracer.setInstances({ { left, 1 }, { right, 2 } });
+        // 위젯 기본 광원 (GL 색 × 1/3)
+        tracer.setLights({ { QVector3D(5.0f, 5.0f, 5.0f), QVector3D(2.0f, 2.0f, 2.0f) / 3.0f },
+                           { QVector3D(-5.0f, 5.0f, 5.0f), QVector3D(1.0f, 1.0f, 0.5f) / 3.0f } });
+        tracer.cameraPos = QVector3D(0.0f, 2.0f, 5.0f);
+        tracer.lightRadius = 1.0f;
+        tracer.lightmap = false;
+
+        QImage reference(options.traceWidth, options.traceHeight, QImage::Format_RGB32);
+        tracer.denoise = false;
+        tracer.samplesPerPixel = options.referenceSamples;
+        tracer.render(reference);
+        FrameArena::endFrame();
+
+        for (int spp : { 1, 4 }) {
+            QImage noisy(options.traceWidth, options.traceHeight, QImage::Format_RGB32);
+            QImage denoised(options.traceWidth, options.traceHeight, QImage::Format_RGB32);
+            tracer.samplesPerPixel = spp;
+            tracer.denoise = false;
+            tracer.render(noisy);
+            FrameArena::endFrame();
+            tracer.denoise = true;
+            RayTracer::RenderStats stats = tracer.render(denoised);
+            FrameArena::endFrame();
+            harness.improves(QString("denoise-soft-shadows-%1spp").arg(spp), rootMeanSquareError(denoised, reference),
+                             rootMeanSquareError(noisy, reference),
+                             QString(" vs %1 spp, denoise %2 ms").arg(options.referenceSamples).arg(stats.denoiseMs, 0, 'f', 1));
+        }
+    }
+
+    return harness.finish();
+}
@@ -0,0 +1,35 @@
+#ifndef REGRESSION_H
+#define REGRESSION_H
+
+#include <QString>
+
+// 성능/이미지 회귀 하네스
+// 고정된 장면(번들 소, 합성 고해상도 메쉬 × 레이 트레이싱/플랫/고러드/하이브리드)을 렌더링해서
+// - golden 이미지와 픽셀 비교 (허용 오차 내)
+// - 머신별 기준 시간과 비교 (maxSlowdownPercent 이상 느려지면 실패)
+// 합성 구의 레이 트레이싱 golden은 저장소(baselineDir)에 있어서 없으면 실패 (--update로만 기록).
+// 래스터/하이브리드/소 golden과 기준 시간은 드라이버/머신마다 달라 localDir에 두고, 없으면 새로 기록
+// (strict면 golden이 없을 때 실패). 레이 트레이싱/로딩은 GL 없이 CPU만으로 실행되고,
+// 래스터 장면은 GL 컨텍스트를 만들 수 없으면 SKIP.
+// 디노이저는 1/4 spp 소프트 섀도우를 디노이즈한 이미지가 디노이즈 전보다 referenceSamples spp 기준에 가까워야 통과.
+struct RegressionOptions {
+    QString baselineDir = "regression";
+    QString localDir;                       // 머신별 golden/기준 시간 위치, 비어 있으면 baselineDir
+    QString cowPath;                        // 비어 있으면 합성 메쉬만
+    bool update = false;                    // 기준 이미지/시간 덮어쓰기
+    bool strict = false;                    // golden이 없으면 새로 기록하지 않고 실패 (ctest)
+    double maxSlowdownPercent = 20.0;
+    int maxChannelDifference = 2;           // 0~255, 이 이상 차이나면 다른 픽셀
+    double maxDifferentPixelsPercent = 0.1;
+    int repeats = 3;                        // 가장 빠른 시간 사용
+    int traceWidth = 128;
+    int traceHeight = 96;
+    int rasterWidth = 400;
+    int rasterHeight = 300;
+    int referenceSamples = 64;              // 디노이저 품질 비교의 기준 이미지 spp
+};
+
+// 0: 통과, 1: 실패
+int runRegression(const RegressionOptions& options);
+
+#endif // REGRESSION_H
@@ -0,0 +1,285 @@
+#include "temporalcache.h"
+#include "framearena.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// 레이가 박스 안에 있는 구간 [t0, t1] (0 ≤ t ≤ maxT)
+bool clipRay(const RayTracer::Ray& ray, const QVector3D& lo, const QVector3D& hi, float maxT, float& t0, float& t1) {
+    t0 = 0.0f;
+    t1 = maxT;
+    for (int axis = 0; axis < 3; ++axis) {
+        float inv = 1.0f / ray.direction[axis];
+        float a = (lo[axis] - ray.origin[axis]) * inv;
+        float b = (hi[axis] - ray.origin[axis]) * inv;
+        if (a > b) std::swap(a, b);
+        t0 = std::max(t0, a);
+        t1 = std::min(t1, b);
+        if (t0 > t1) return false;
+    }
+    return true;
+}
+
+// 삼각형과 박스가 겹치는지 (분리축: 박스 축 3 + 삼각형 법선 1 + 변 × 박스 축 9)
+bool triangleOverlapsBox(const QVector3D& a, const QVector3D& b, const QVector3D& c, const QVector3D& lo, const QVector3D& hi) {
+    const QVector3D center = (lo + hi) * 0.5f;
+    const QVector3D half = (hi - lo) * 0.5f;
+    const QVector3D v[3] = { a - center, b - center, c - center };
+    auto separated = [&](const QVector3D& axis) {
+        float p0 = QVector3D::dotProduct(v[0], axis);
+        float p1 = QVector3D::dotProduct(v[1], axis);
+        float p2 = QVector3D::dotProduct(v[2], axis);
+        float r = half.x() * std::fabs(axis.x()) + half.y() * std::fabs(axis.y()) + half.z() * std::fabs(axis.z());
+        return std::min({ p0, p1, p2 }) > r || std::max({ p0, p1, p2 }) < -r;
+    };
+
+    const QVector3D boxAxes[3] = { QVector3D(1, 0, 0), QVector3D(0, 1, 0), QVector3D(0, 0, 1) };
+    const QVector3D edges[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+    for (const QVector3D& axis : boxAxes) {
+        if (separated(axis)) return false;
+    }
+    if (separated(QVector3D::crossProduct(edges[0], edges[1]))) return false;
+    for (const QVector3D& edge : edges) {
+        for (const QVector3D& axis : boxAxes) {
+            if (separated(QVector3D::crossProduct(axis, edge))) return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool TemporalCache::Settings::operator==(const Settings& other) const {
+    return width == other.width && height == other.height && cameraPos == other.cameraPos &&
+           maxDepth == other.maxDepth && samplesPerPixel == other.samplesPerPixel &&
+           lightRadius == other.lightRadius && exhaustiveLightLimit == other.exhaustiveLightLimit &&
+           russianRoulette == other.russianRoulette && rouletteThreshold == other.rouletteThreshold &&
+           shadows == other.shadows && reflections == other.reflections && lightmap == other.lightmap &&
+           lightmapDensity == other.lightmapDensity && lightmapSamples == other.lightmapSamples &&
+           sceneVersion == other.sceneVersion;
+}
+
+TemporalCache::Settings TemporalCache::capture(const RayTracer& tracer, int width, int height) {
+    Settings s;
+    s.width = width;
+    s.height = height;
+    s.cameraPos = tracer.cameraPos;
+    s.maxDepth = tracer.maxDepth;
+    s.samplesPerPixel = tracer.samplesPerPixel;
+    s.lightRadius = tracer.lightRadius;
+    s.exhaustiveLightLimit = tracer.exhaustiveLightLimit;
+    s.russianRoulette = tracer.russianRoulette;
+    s.rouletteThreshold = tracer.rouletteThreshold;
+    s.shadows = tracer.shadows;
+    s.reflections = tracer.reflections;
+    s.lightmap = tracer.lightmap;
+    s.lightmapDensity = tracer.lightmapDensity;
+    s.lightmapSamples = tracer.lightmapSamples;
+    s.sceneVersion = tracer.sceneVersion();
+    return s;
+}
+
+RayTracer::RenderStats TemporalCache::render(const RayTracer& tracer, QImage& image) {
+    using Clock = std::chrono::steady_clock;
+    RayTracer::RenderStats stats;
+    FrameArena& arena = FrameArena::local();
+
+    const int w = image.width();
+    const int h = image.height();
+    const size_t count = size_t(w) * h;
+    const Settings current = capture(tracer, w, h);
+    const std::vector<RayTracer::Instance>& sceneInstances = tracer.instances();
+
+    bool full = !enabled || !valid || !(current == settings) || instances.size() != sceneInstances.size();
+    if (r.size() != count) {
+        for (std::vector<float>* plane : { &r, &g, &b, &nx, &ny, &nz, &depth, &variance }) plane->resize(count);
+        objectId.resize(count);
+        segments.resize(count);
+        full = true;
+    }
+
+    // 바뀐 인스턴스마다 이전 ∪ 새 월드 바운딩 박스 (lo, hi 쌍)
+    QVector3D* bounds = arena.allocateArray<QVector3D>(sceneInstances.size() * 4);
+    int boundsCount = 0;
+    for (size_t k = 0; k < sceneInstances.size() && !full; ++k) {
+        if (sceneInstances[k].objectId != instances[k].objectId) {
+            full = true;
+        } else if (!(sceneInstances[k].transform == instances[k].transform)) {
+            QVector3D oldMin, oldMax, newMin, newMax;
+            tracer.worldBounds(instances[k].transform, oldMin, oldMax);
+            tracer.worldBounds(sceneInstances[k].transform, newMin, newMax);
+            bounds[2 * boundsCount] = QVector3D(std::min(oldMin.x(), newMin.x()), std::min(oldMin.y(), newMin.y()), std::min(oldMin.z(), newMin.z()));
+            bounds[2 * boundsCount + 1] = QVector3D(std::max(oldMax.x(), newMax.x()), std::max(oldMax.y(), newMax.y()), std::max(oldMax.z(), newMax.z()));
+            boundsCount++;
+        }
+    }
+
+    // 기록 버퍼에 바로 추적
+    GBuffer records;
+    records.width = w;
+    records.height = h;
+    records.r = r.data();
+    records.g = g.data();
+    records.b = b.data();
+    records.nx = nx.data();
+    records.ny = ny.data();
+    records.nz = nz.data();
+    records.depth = depth.data();
+    records.objectId = objectId.data();
+    records.variance = variance.data();
+
+    Lightmap::Stats lightmapStats = tracer.updateLightmap(); // 이후 추적 호출에서는 바로 반환
+    stats.lightmapMs = lightmapStats.bakeMs;
+    stats.lightmapTexels = lightmapStats.bakedTexels;
+
+    auto traceStart = Clock::now();
+    uint64_t tracedSegments = 0;
+    size_t tracedPixels = 0;
+    if (full) {
+        tracedSegments = tracer.traceRegion(records, 0, 0, w, h, segments.data());
+        tracedPixels = count;
+    } else if (boundsCount > 0) {
+        // 반사 레이가 닿을 수 있는 범위 (현재 인스턴스 전체)
+        QVector3D* instanceBounds = bounds + 2 * boundsCount;
+        for (size_t k = 0; k < sceneInstances.size(); ++k) {
+            tracer.worldBounds(sceneInstances[k].transform, instanceBounds[2 * k], instanceBounds[2 * k + 1]);
+        }
+        int* pixels = nullptr;
+        int dirty = collectDirtyPixels(tracer, bounds, boundsCount, instanceBounds, int(sceneInstances.size()), pixels);
+        tracedSegments = tracer.tracePixels(records, pixels, dirty, segments.data());
+        tracedPixels = size_t(dirty);
+    }
+    stats.traceMs = std::chrono::duration<double, std::milli>(Clock::now() - traceStart).count();
+    stats.tracedFraction = count ? double(tracedPixels) / double(count) : 0.0;
+    stats.averagePathLength = tracedPixels ? double(tracedSegments) / (double(tracedPixels) * std::max(1, tracer.samplesPerPixel)) : 0.0;
+
+    settings = current;
+    instances = sceneInstances;
+    valid = enabled;
+
+    // 디노이저는 radiance 평면을 핑퐁 버퍼로 덮어쓰므로 복사본으로 resolve
+    GBuffer frame = records;
+    frame.r = arena.allocateArray<float>(count);
+    frame.g = arena.allocateArray<float>(count);
+    frame.b = arena.allocateArray<float>(count);
+    std::memcpy(frame.r, records.r, count * sizeof(float));
+    std::memcpy(frame.g, records.g, count * sizeof(float));
+    std::memcpy(frame.b, records.b, count * sizeof(float));
+    stats.denoiseMs = tracer.resolve(frame, image);
+    return stats;
+}
+
+// 바뀐 박스와 만날 수 있는 기록을 표시 → 한 픽셀 넓힘 → 목록 (프레임 아레나)
+int TemporalCache::collectDirtyPixels(const RayTracer& tracer, const QVector3D* bounds, int boundsCount,
+                                      const QVector3D* instanceBounds, int instanceCount, int*& pixels) const {
+    ThreadPool& pool = ThreadPool::instance();
+    FrameArena& arena = FrameArena::local();
+    const int w = settings.width;
+    const int h = settings.height;
+    const QVector3D camera = tracer.cameraPos;
+    const std::vector<RayTracer::Light>& lights = tracer.lights();
+    const QVector3D margin(1e-3f, 1e-3f, 1e-3f);
+    const QVector3D lightMargin = margin + QVector3D(tracer.lightRadius, tracer.lightRadius, tracer.lightRadius);
+    // 바닥 점은 텍셀 하나 거리 안의 텍셀들을 보간: 그 텍셀들의 선분은 이 점의 선분에서 텍셀 크기 안쪽
+    const float texel = tracer.lightmap ? tracer.lightmapTexelSize() : 0.0f;
+    const QVector3D floorMargin = lightMargin + QVector3D(texel, texel, texel);
+
+    // 점 → 광원 선분이 바뀐 박스를 지나는지
+    auto shadowInvalid = [&](const QVector3D& point, bool floor) {
+        const QVector3D& grow = floor ? floorMargin : lightMargin;
+        for (int k = 0; k < boundsCount; ++k) {
+            for (const RayTracer::Light& light : lights) {
+                RayTracer::Ray shadow{ point, light.position - point };
+                if (RayTracer::intersectBounds(shadow, bounds[2 * k] - grow, bounds[2 * k + 1] + grow, 1.0f)) return true;
+            }
+        }
+        return false;
+    };
+
+    // 반사 한 번 (세그먼트 2개): 반사 레이, 반사 레이가 맞힐 수 있는 구간(인스턴스 박스 안, 바닥)의 그림자
+    auto reflectionInvalid = [&](const QVector3D& position, const QVector3D& dir, const QVector3D& normal) {
+        QVector3D reflectDir = dir - 2.0f * QVector3D::dotProduct(dir, normal) * normal;
+        RayTracer::Ray ray{ position + normal * 0.01f, reflectDir.normalized() };
+        float floorT = 1e6f;
+        if (ray.direction.y() < -1e-6f) {
+            float t = (-1.0f - ray.origin.y()) / ray.direction.y();
+            QVector3D q = ray.origin + t * ray.direction;
+            if (std::fabs(q.x()) <= 10.0f && std::fabs(q.z()) <= 10.0f) {
+                floorT = t;
+                if (shadowInvalid(q, true)) return true;
+            }
+        }
+        for (int k = 0; k < boundsCount; ++k) {
+            if (RayTracer::intersectBounds(ray, bounds[2 * k] - margin, bounds[2 * k + 1] + margin, floorT)) return true;
+        }
+        for (int j = 0; j < instanceCount; ++j) {
+            float t0, t1;
+            if (!clipRay(ray, instanceBounds[2 * j] - margin, instanceBounds[2 * j + 1] + margin, floorT, t0, t1)) continue;
+            const QVector3D a = ray.origin + t0 * ray.direction;
+            const QVector3D b = ray.origin + t1 * ray.direction;
+            for (int k = 0; k < boundsCount; ++k) {
+                for (const RayTracer::Light& light : lights) {
+                    if (triangleOverlapsBox(a, b, light.position, bounds[2 * k] - lightMargin, bounds[2 * k + 1] + lightMargin)) return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    uint8_t* dirty = arena.allocateArray<uint8_t>(size_t(w) * h);
+    pool.parallelFor(h, [&](int y, int) {
+        for (int x = 0; x < w; ++x) {
+            const size_t i = size_t(y) * w + x;
+
+            // 첫 샘플과 같은 1차 레이 (픽셀 중심)
+            QVector3D dir((2.0f * x / w) - 1.0f, 1.0f - (2.0f * y / h), -1.0f);
+            dir.normalize();
+            bool invalid = false;
+            for (int k = 0; k < boundsCount && !invalid; ++k) {
+                invalid = RayTracer::intersectBounds({ camera, dir }, bounds[2 * k] - margin, bounds[2 * k + 1] + margin, depth[i]);
+            }
+            if (!invalid && objectId[i] >= 0) {
+                const QVector3D position = camera + dir * depth[i];
+                invalid = shadowInvalid(position, objectId[i] == 0);
+                if (!invalid && objectId[i] != 0 && segments[i] >= 2) {
+                    // 반사를 두 번 넘게 따라간 경로는 따라가지 않고 다시 추적
+                    invalid = segments[i] > 2 || reflectionInvalid(position, dir, QVector3D(nx[i], ny[i], nz[i]));
+                }
+            }
+            dirty[i] = invalid;
+        }
+    });
+
+    uint8_t* marked = arena.allocateArray<uint8_t>(size_t(w) * h);
+    int* rowStart = arena.allocateArray<int>(size_t(h) + 1);
+    pool.parallelFor(h, [&](int y, int) {
+        int rowCount = 0;
+        for (int x = 0; x < w; ++x) {
+            bool any = false;
+            for (int yy = std::max(0, y - 1); yy <= std::min(h - 1, y + 1) && !any; ++yy) {
+                for (int xx = std::max(0, x - 1); xx <= std::min(w - 1, x + 1) && !any; ++xx) {
+                    any = dirty[size_t(yy) * w + xx];
+                }
+            }
+            marked[size_t(y) * w + x] = any;
+            rowCount += any;
+        }
+        rowStart[y + 1] = rowCount;
+    });
+    rowStart[0] = 0;
+    for (int y = 0; y < h; ++y) rowStart[y + 1] += rowStart[y];
+
+    pixels = arena.allocateArray<int>(size_t(std::max(1, rowStart[h])));
+    pool.parallelFor(h, [&](int y, int) {
+        int* out = pixels + rowStart[y];
+        for (int x = 0; x < w; ++x) {
+            if (marked[size_t(y) * w + x]) *out++ = y * w + x;
+        }
+    });
+    return rowStart[h];
+}
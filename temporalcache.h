@@ -0,0 +1,65 @@
+#ifndef TEMPORALCACHE_H
+#define TEMPORALCACHE_H
+
+#include <QImage>
+#include <cstdint>
+#include <vector>
+
+#include "raytracer.h"
+
+// 이전 레이 트레이싱 프레임의 픽셀별 기록을 다음 프레임에 재사용
+// - 기록: 1차 히트 거리/법선/objectId, 디노이즈 전 radiance, 가장 긴 샘플 경로의 세그먼트 수
+// - 카메라가 고정이라 재투영 위치는 같은 픽셀. 크기/카메라/광원/텍스처/트레이서 설정이 바뀌면 전체 추적
+// - 인스턴스 변환이 바뀌면 그 인스턴스의 이전 ∪ 새 월드 바운딩 박스와 겹칠 수 있는 픽셀만 다시 추적:
+//   1차 레이(히트 앞까지), 히트점 → 광원 선분(광원 반지름만큼 넓힌 박스),
+//   반사 한 번: 반사 레이와 반사 레이가 맞힐 수 있는 구간에서 광원까지의 영역. 반사가 더 깊으면 항상
+// - 바닥 라이트맵을 쓰면 바닥 점의 그림자 박스를 텍셀 크기만큼 더 넓힘 (주변 텍셀을 보간하므로)
+// - 지터 샘플을 위해 다시 추적할 영역을 한 픽셀 넓힘
+// 1 spp 하드 섀도우에서는 전체 추적과 같은 이미지
+class TemporalCache {
+public:
+    bool enabled = true;
+
+    // 메쉬를 바꿨을 때 (인스턴스 변환만으로는 알 수 없음)
+    void invalidate() { valid = false; }
+
+    // RayTracer::render()와 같은 결과. tracedFraction에 다시 추적한 픽셀 비율
+    RayTracer::RenderStats render(const RayTracer& tracer, QImage& image);
+
+private:
+    // 바뀌면 전체 추적이 필요한 설정
+    struct Settings {
+        int width = 0;
+        int height = 0;
+        QVector3D cameraPos;
+        int maxDepth = 0;
+        int samplesPerPixel = 0;
+        float lightRadius = 0.0f;
+        int exhaustiveLightLimit = 0;
+        bool russianRoulette = false;
+        float rouletteThreshold = 0.0f;
+        bool shadows = false;
+        bool reflections = false;
+        bool lightmap = false;
+        float lightmapDensity = 0.0f;
+        int lightmapSamples = 0;
+        unsigned sceneVersion = 0;
+
+        bool operator==(const Settings& other) const;
+    };
+
+    static Settings capture(const RayTracer& tracer, int width, int height);
+    int collectDirtyPixels(const RayTracer& tracer, const QVector3D* bounds, int boundsCount,
+                           const QVector3D* instanceBounds, int instanceCount, int*& pixels) const;
+
+    bool valid = false;
+    Settings settings;
+    std::vector<RayTracer::Instance> instances;
+
+    // 이전 프레임 기록 (이미지 크기가 바뀔 때만 재할당)
+    std::vector<float> r, g, b, nx, ny, nz, depth, variance;
+    std::vector<int> objectId;
+    std::vector<uint8_t> segments;
+};
+
+#endif // TEMPORALCACHE_H
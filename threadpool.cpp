@@ -0,0 +1,83 @@
+#include "threadpool.h"
+
+#include "framearena.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threadCount) {
+    for (int i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (auto& thread : threads) thread.join();
+}
+
+static std::atomic<int> instanceWorkers{0};
+
+void ThreadPool::setInstanceWorkerCount(int workers) {
+    instanceWorkers = workers;
+}
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool(std::max(1, instanceWorkers > 0 ? instanceWorkers.load()
+                                                            : int(std::thread::hardware_concurrency())) - 1);
+    return pool;
+}
+
+void ThreadPool::run(int count, Task task, const void* context) {
+    if (count <= 0) return;
+
+    if (threads.empty()) {
+        for (int i = 0; i < count; ++i) task(context, i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = task;
+        this->context = context;
+        this->count = count;
+        next.store(0);
+        pending = int(threads.size());
+        ++generation;
+    }
+    wakeCondition.notify_all();
+
+    drain(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this] { return pending == 0; });
+}
+
+void ThreadPool::drain(int worker) {
+    int index;
+    while ((index = next.fetch_add(1)) < count) {
+        task(context, index, worker);
+    }
+}
+
+void ThreadPool::workerLoop(int worker) {
+    FrameArena::local(); // 스레드 아레나를 미리 만들어 첫 프레임 이후 할당이 없도록
+
+    int seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+        }
+
+        drain(worker);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0) doneCondition.notify_one();
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 고정 워커 스레드 풀
+// - parallelFor()는 힙 할당 없이 작업을 나눠줌 (함수 포인터 + 컨텍스트)
+// - 호출 스레드도 worker 0으로 참여
+// - 한 번에 하나의 parallelFor만, 메인 스레드에서만 호출
+class ThreadPool {
+public:
+    explicit ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    static ThreadPool& instance();
+    // instance()를 처음 부르기 전에만 효과 (0이면 하드웨어 스레드 수). 한 머신에 워커 프로세스를 여럿 띄울 때
+    static void setInstanceWorkerCount(int workers);
+
+    int workerCount() const { return int(threads.size()) + 1; }
+
+    // fn(index, worker): index ∈ [0, count), worker ∈ [0, workerCount())
+    template<typename Fn>
+    void parallelFor(int count, const Fn& fn) {
+        run(count, [](const void* context, int index, int worker) {
+            (*static_cast<const Fn*>(context))(index, worker);
+        }, &fn);
+    }
+
+private:
+    using Task = void (*)(const void* context, int index, int worker);
+
+    void run(int count, Task task, const void* context);
+    void drain(int worker);
+    void workerLoop(int worker);
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+
+    Task task = nullptr;
+    const void* context = nullptr;
+    int count = 0;
+    std::atomic<int> next{0};
+
+    int generation = 0;
+    int pending = 0;
+    bool stopping = false;
+};
+
+#endif // THREADPOOL_H